@@ -0,0 +1,539 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#define GL_GLEXT_PROTOTYPES
+#include <GL/glcorearb.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <HexPongCore/AI.h>
+#include <HexPongCore/Match.h>
+#include <HexPongCore/Raster.h>
+#include <HexPong/Scene.h>
+
+// Draws the game's scene with its own shaders, buffers and FrameRing on an
+// offscreen GL 4.5 context through EGL without a display (Mesa llvmpipe on
+// a headless machine), and checks the render paths HexPong switches
+// between with B and I against each other and against Raster:
+//   batched scene program vs the four per-object programs,
+//   one instanced pass vs one pass per view,
+//   the batched instanced frame vs Raster::Renderer.
+// Frames come from a match stepped every frame, each drawn through the
+// ring, so that a slot written late or read stale shows up as a
+// difference. Exits 0 when all agree, 1 when not, 77 without a context.
+
+using namespace OpenGL;
+
+struct Options
+{
+	char const* roster;
+	char const* shaders;
+	char const* output;
+	unsigned long long frames;
+	unsigned int every;
+	unsigned int side;
+
+	Options()
+		:
+		roster("BEPBSB"),
+		shaders(HEXPONG_SHADERS),
+		output(nullptr),
+		frames(600),
+		every(50),
+		side(200)
+	{
+	}
+	bool parse(int argc, char** argv)
+	{
+		for (int c0(1); c0 < argc; ++c0)
+		{
+			if (!strcmp(argv[c0], "-r") && c0 + 1 < argc)roster = argv[++c0];
+			else if (!strcmp(argv[c0], "-s") && c0 + 1 < argc)shaders = argv[++c0];
+			else if (!strcmp(argv[c0], "-o") && c0 + 1 < argc)output = argv[++c0];
+			else if (!strcmp(argv[c0], "-f") && c0 + 1 < argc)frames = strtoull(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-k") && c0 + 1 < argc)every = strtoul(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-S") && c0 + 1 < argc)side = strtoul(argv[++c0], nullptr, 10);
+			else return false;
+		}
+		if (strlen(roster) < 3 || strlen(roster) > maxSides || !every || side < 16)return false;
+		for (char const* p(roster); *p; ++p)
+			if (!validSeat(*p))return false;
+		return true;
+	}
+};
+
+// A GL 4.5 core context with no surface; everything is drawn into an FBO.
+struct Context
+{
+	EGLDisplay display;
+	EGLContext context;
+
+	Context()
+		:
+		display(EGL_NO_DISPLAY),
+		context(EGL_NO_CONTEXT)
+	{
+	}
+	~Context()
+	{
+		if (context != EGL_NO_CONTEXT)
+		{
+			eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			eglDestroyContext(display, context);
+		}
+		if (display != EGL_NO_DISPLAY)eglTerminate(display);
+	}
+	bool init()
+	{
+		display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		if (display == EGL_NO_DISPLAY)display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		EGLint major, minor;
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+		{
+			display = EGL_NO_DISPLAY;
+			return false;
+		}
+		if (!eglBindAPI(EGL_OPENGL_API))return false;
+		EGLint const attributes[] =
+		{
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 5,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE,
+		};
+		context = eglCreateContext(display, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, attributes);
+		return context != EGL_NO_CONTEXT && eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context);
+	}
+};
+
+//<_name>Vertex0.cpp and <_name>Fragment0.cpp, as ShaderLists.txt attaches them
+GLuint program(char const* _dir, char const* _name)
+{
+	GLuint a(glCreateProgram());
+	char const* stages[2] = { "Vertex", "Fragment" };
+	GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	for (unsigned int c0(0); c0 < 2; ++c0)
+	{
+		std::string path(std::string(_dir) + "/" + _name + stages[c0] + "0.cpp");
+		FILE* file(fopen(path.c_str(), "rb"));
+		if (!file)
+		{
+			printf("Cannot read %s\n", path.c_str());
+			return 0;
+		}
+		std::string source;
+		char buffer[4096];
+		for (size_t n; (n = fread(buffer, 1, sizeof(buffer), file));)
+			source.append(buffer, n);
+		fclose(file);
+		GLuint shader(glCreateShader(types[c0]));
+		char const* text(source.c_str());
+		glShaderSource(shader, 1, &text, nullptr);
+		glCompileShader(shader);
+		GLint ok(0);
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+		if (!ok)
+		{
+			char log[4096];
+			glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+			printf("%s:\n%s\n", path.c_str(), log);
+			return 0;
+		}
+		glAttachShader(a, shader);
+		glDeleteShader(shader);
+	}
+	glLinkProgram(a);
+	GLint ok(0);
+	glGetProgramiv(a, GL_LINK_STATUS, &ok);
+	if (!ok)
+	{
+		char log[4096];
+		glGetProgramInfoLog(a, sizeof(log), nullptr, log);
+		printf("%s: %s\n", _name, log);
+		return 0;
+	}
+	return a;
+}
+
+// The game's five programs with the buffers HexPong uploads for them,
+// bound the way its VertexAttribs bind them, drawn the way their run()s
+// draw.
+struct Renderers
+{
+	enum
+	{
+		Border,
+		Player,
+		Ball,
+		Circle,
+		Scene,
+		count
+	};
+	GLuint programs[count];
+	GLuint arrays[count];
+	GLuint buffers[count];
+	Mesh::LineVertex lines[maxSides];
+	Mesh::Rectangle rectangles[maxSides];
+	Mesh::SceneVertex vertices[Mesh::sceneCapacity];
+	unsigned int borderCount;
+	unsigned int paddleCount;
+	unsigned int sceneLines;
+	unsigned int sceneTriangles;
+	float radius;
+
+	Renderers()
+		:
+		programs{ 0 },
+		arrays{ 0 },
+		buffers{ 0 },
+		borderCount(0),
+		paddleCount(0),
+		sceneLines(0),
+		sceneTriangles(0),
+		radius(0)
+	{
+	}
+	~Renderers()
+	{
+		glDeleteVertexArrays(count, arrays);
+		glDeleteBuffers(count, buffers);
+		for (unsigned int c0(0); c0 < count; ++c0)
+			if (programs[c0])glDeleteProgram(programs[c0]);
+	}
+	bool init(char const* _shaders)
+	{
+		char const* names[count] = { "Border", "Player", "Ball", "Circle", "Scene" };
+		for (unsigned int c0(0); c0 < count; ++c0)
+			if (!(programs[c0] = program(_shaders, names[c0])))return false;
+		glCreateVertexArrays(count, arrays);
+		glCreateBuffers(count, buffers);
+		attribute(Border, 0, 2, sizeof(Mesh::LineVertex), 0);
+		attribute(Border, 1, 3, sizeof(Mesh::LineVertex), sizeof(Math::vec2<float>));
+		attribute(Player, 0, 2, sizeof(Math::vec2<float>), 0);
+		attribute(Ball, 0, 2, sizeof(Math::vec2<float>), 0);
+		attribute(Circle, 0, 2, sizeof(Math::vec2<float>), 0);
+		attribute(Scene, 0, 2, sizeof(Mesh::SceneVertex), 0);
+		attribute(Scene, 1, 2, sizeof(Mesh::SceneVertex), sizeof(Math::vec2<float>));
+		attribute(Scene, 2, 2, sizeof(Mesh::SceneVertex), 2 * sizeof(Math::vec2<float>));
+		return true;
+	}
+	void attribute(unsigned int _renderer, GLuint _location, GLint _size, GLsizei _stride, GLuint _offset)
+	{
+		glVertexArrayVertexBuffer(arrays[_renderer], 0, buffers[_renderer], 0, _stride);
+		glEnableVertexArrayAttrib(arrays[_renderer], _location);
+		glVertexArrayAttribFormat(arrays[_renderer], _location, _size, GL_FLOAT, GL_FALSE, _offset);
+		glVertexArrayAttribBinding(arrays[_renderer], _location, 0);
+	}
+	//what HexPong::retune builds and uploads
+	void build(Arena const& _arena, Tuning const& _tuning)
+	{
+		borderCount = Mesh::border(_arena, _tuning, lines);
+		paddleCount = Mesh::paddles(_arena, _tuning, rectangles);
+		Mesh::scene(_arena, _tuning, vertices, sceneLines, sceneTriangles);
+		radius = float(_tuning.scale / _arena.R * _tuning.r0);
+		float const origin[2] = { 0, 0 };
+		glNamedBufferData(buffers[Border], sizeof(lines), lines, GL_STATIC_DRAW);
+		glNamedBufferData(buffers[Player], sizeof(rectangles), rectangles, GL_STATIC_DRAW);
+		glNamedBufferData(buffers[Ball], sizeof(origin), origin, GL_STATIC_DRAW);
+		glNamedBufferData(buffers[Circle], sizeof(origin), origin, GL_DYNAMIC_DRAW);
+		glNamedBufferData(buffers[Scene], sizeof(vertices), vertices, GL_STATIC_DRAW);
+	}
+	void use(unsigned int _renderer)
+	{
+		glUseProgram(programs[_renderer]);
+		glBindVertexArray(arrays[_renderer]);
+	}
+	//SceneRenderer::run
+	void batched(GLsizei _instances)
+	{
+		use(Scene);
+		glDrawArraysInstanced(GL_LINES, 0, sceneLines, _instances);
+		glDrawArraysInstanced(GL_TRIANGLES, sceneLines, sceneTriangles, _instances);
+	}
+	//the four run()s, _pixels the side of a view
+	void separate(GLsizei _instances, float _pixels)
+	{
+		use(Border);
+		glDrawArraysInstanced(GL_LINE_LOOP, 0, borderCount, _instances);
+		use(Player);
+		glDrawArraysInstanced(GL_TRIANGLES, 0, paddleCount * 2 * 3, _instances);
+		use(Circle);
+		glPointSize(_pixels * radius);
+		glDrawArraysInstanced(GL_POINTS, 0, 1, _instances);
+		use(Ball);
+		glPointSize(float(10 * _pixels / windowSize));
+		glDrawArraysInstanced(GL_POINTS, 0, 1, _instances);
+	}
+};
+
+struct Target
+{
+	GLuint framebuffer;
+	GLuint color;
+	unsigned int width;
+	unsigned int height;
+
+	Target(unsigned int _width, unsigned int _height)
+		:
+		framebuffer(0),
+		color(0),
+		width(_width),
+		height(_height)
+	{
+		glCreateRenderbuffers(1, &color);
+		glNamedRenderbufferStorage(color, GL_RGBA8, width, height);
+		glCreateFramebuffers(1, &framebuffer);
+		glNamedFramebufferRenderbuffer(framebuffer, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+	~Target()
+	{
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(1, &color);
+	}
+	bool complete()const
+	{
+		return glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	}
+	//rows flipped to Raster's top-down order, alpha left opaque
+	void read(Raster::Image& _image)const
+	{
+		std::vector<unsigned char> rows(size_t(width) * height * 4);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rows.data());
+		for (unsigned int c0(0); c0 < height; ++c0)
+			memcpy(_image.rgba.data() + size_t(c0) * width * 4, rows.data() + size_t(height - 1 - c0) * width * 4, size_t(width) * 4);
+		for (size_t c0(3); c0 < _image.rgba.size(); c0 += 4)_image.rgba[c0] = 255;
+	}
+};
+
+// HexPong::run for one frame: write the ring, then one instanced pass or
+// one pass per view, batched or through the four programs.
+void render(Renderers& _renderers, FrameRing& _ring, Physics const& _physics, ViewLayout const& _layout,
+	Target const& _target, bool _instanced, bool _batched)
+{
+	double width(_target.width), height(_target.height);
+	_ring.write(_physics.arena, _physics.offsets, _physics.r, _layout, _instanced, width, height);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	glClear(GL_COLOR_BUFFER_BIT);
+	double x, y, side;
+	_layout.tile(0, width, height, x, y, side);
+	GLsizei instances(_instanced ? _layout.views : 1);
+	for (unsigned int c0(0); c0 < (_instanced ? 1 : _layout.views); ++c0)
+	{
+		if (_instanced)glViewport(0, 0, GLsizei(width), GLsizei(height));
+		else
+		{
+			_layout.tile(c0, width, height, x, y, side);
+			glViewport(GLint(x), GLint(y), GLsizei(side), GLsizei(side));
+		}
+		_ring.bind(c0);
+		if (_batched)_renderers.batched(instances);
+		else _renderers.separate(instances, float(side));
+	}
+	_ring.fence();
+}
+
+// Pixels of _a that no pixel of _b within _reach matches to within
+// _tolerance in every channel: two rasterizers may put an edge a pixel
+// apart, but must not draw anything the other does not.
+unsigned long long unmatched(Raster::Image const& _a, Raster::Image const& _b, int _reach, int _tolerance)
+{
+	unsigned long long a(0);
+	int w(int(_a.width)), h(int(_a.height));
+	for (int y(0); y < h; ++y)
+		for (int x(0); x < w; ++x)
+		{
+			unsigned char const* p(_a.rgba.data() + (size_t(y) * w + x) * 4);
+			bool found(false);
+			for (int dy(-_reach); !found && dy <= _reach; ++dy)
+				for (int dx(-_reach); !found && dx <= _reach; ++dx)
+				{
+					int qx(x + dx), qy(y + dy);
+					if (qx < 0 || qy < 0 || qx >= w || qy >= h)continue;
+					unsigned char const* q(_b.rgba.data() + (size_t(qy) * w + qx) * 4);
+					found = abs(p[0] - q[0]) <= _tolerance && abs(p[1] - q[1]) <= _tolerance &&
+						abs(p[2] - q[2]) <= _tolerance;
+				}
+			a += !found;
+		}
+	return a;
+}
+
+unsigned long long different(Raster::Image const& _a, Raster::Image const& _b)
+{
+	unsigned long long a(0);
+	for (size_t c0(0); c0 < _a.rgba.size(); c0 += 4)
+		a += memcmp(_a.rgba.data() + c0, _b.rgba.data() + c0, 3) != 0;
+	return a;
+}
+
+// Totals of one comparison over every checked frame; passes while the
+// unmatched pixels stay within _budget of all pixels compared.
+struct Comparison
+{
+	char const* name;
+	int reach;
+	int tolerance;
+	double budget;
+	unsigned long long pixels;
+	unsigned long long differing;
+	unsigned long long misses;
+
+	Comparison(char const* _name, int _reach, int _tolerance, double _budget)
+		:
+		name(_name),
+		reach(_reach),
+		tolerance(_tolerance),
+		budget(_budget),
+		pixels(0),
+		differing(0),
+		misses(0)
+	{
+	}
+	void add(Raster::Image const& _a, Raster::Image const& _b)
+	{
+		pixels += _a.rgba.size() / 4;
+		differing += different(_a, _b);
+		misses += unmatched(_a, _b, reach, tolerance) + unmatched(_b, _a, reach, tolerance);
+	}
+	bool passed()const
+	{
+		return misses <= budget * pixels;
+	}
+	void print()const
+	{
+		printf("%-40s %10llu %10llu %10llu  %s\n", name, pixels, differing, misses, passed() ? "passed" : "FAILED");
+	}
+};
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!options.parse(argc, argv))
+	{
+		printf("Usage: GLCheck [-r roster] [-f frames] [-k every] [-S side] [-s shaders] [-o prefix]\n"
+			"  -r  3 to 32 seat codes as in Headless; the arena has one side per seat\n"
+			"  -f  frames to step and draw, -k compares every k-th of them\n"
+			"  -S  side of a view in pixels\n"
+			"  -s  directory of the shader sources (default %s)\n"
+			"  -o  write <prefix>-<layout>-scene.png, -programs.png and -raster.png of the\n"
+			"      first compared frame of each layout\n",
+			HEXPONG_SHADERS);
+		return 1;
+	}
+	Context context;
+	if (!context.init())
+	{
+		printf("No GL 4.5 core context through EGL (error 0x%x); skipped\n", eglGetError());
+		return 77;
+	}
+	printf("%s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+
+	unsigned int sides((unsigned int)strlen(options.roster));
+	Match match(sides);
+	std::unique_ptr<Player> players[maxSides];
+	for (unsigned int c0(0); c0 < sides; ++c0)
+	{
+		players[c0].reset(createPlayer(SeatKind(options.roster[c0]), &match.physics, c0));
+		match.players[c0] = players[c0].get();
+	}
+	Renderers renderers;
+	if (!renderers.init(options.shaders))return 1;
+	renderers.build(match.physics.arena, match.physics.tuning);
+	FrameRing ring;
+	ring.init();
+	ring.scale = match.physics.tuning.scale / match.physics.arena.R;
+
+	// The GL paths may put an edge a pixel apart (a point sprite and a quad,
+	// a tile offset and a viewport round differently) and shading may round
+	// the other way, but every pixel must be matched next to it; a frame
+	// drawn from a stale ring slot moves the ball and fails here. Raster
+	// breaks ties where a paddle's inner edge lies on the border line the
+	// other way and draws lines its own way, which leaves a few pixels per
+	// view unmatched.
+	Comparison comparisons[] =
+	{
+		{ "batched vs four programs, instanced", 1, 2, 0 },
+		{ "batched vs four programs, per view", 1, 2, 0 },
+		{ "instanced vs per view, batched", 1, 2, 0 },
+		{ "instanced vs per view, four programs", 1, 2, 0 },
+		{ "batched instanced vs Raster", 1, 2, 5e-4 },
+	};
+	ViewLayout layouts[2] = { ViewLayout::split(sides), ViewLayout::all(sides) };
+	char const* layoutNames[2] = { "split", "all" };
+	bool written[2] = { false, false };
+	std::unique_ptr<Target> targets[2];
+	for (unsigned int c0(0); c0 < 2; ++c0)
+	{
+		targets[c0].reset(new Target(options.side * layouts[c0].cols, options.side * layouts[c0].rows));
+		if (!targets[c0]->complete())
+		{
+			printf("Incomplete framebuffer\n");
+			return 1;
+		}
+	}
+	unsigned long long checked(0);
+	for (unsigned long long c0(0); c0 < options.frames; ++c0)
+	{
+		match.step();
+		//the layouts take turns between compared frames
+		unsigned int l(unsigned(c0 / options.every & 1));
+		Target const& target(*targets[l]);
+		glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+		if (c0 % options.every)
+		{
+			//stepped and drawn like the game, not read back
+			render(renderers, ring, match.physics, layouts[l], target, true, true);
+			continue;
+		}
+		++checked;
+		Raster::Image images[4]{ { target.width, target.height }, { target.width, target.height },
+			{ target.width, target.height }, { target.width, target.height } };
+		for (unsigned int c1(0); c1 < 4; ++c1)
+		{
+			render(renderers, ring, match.physics, layouts[l], target, c1 < 2, c1 % 2 == 0);
+			target.read(images[c1]);
+		}
+		Raster::Renderer raster(options.side, layouts[l].views, sides, match.physics.tuning);
+		raster.render(Raster::Frame::capture(match.physics, c0));
+		comparisons[0].add(images[0], images[1]);
+		comparisons[1].add(images[2], images[3]);
+		comparisons[2].add(images[0], images[2]);
+		comparisons[3].add(images[1], images[3]);
+		comparisons[4].add(images[0], raster.image);
+		if (options.output && !written[l])
+		{
+			written[l] = true;
+			Raster::Image const* outputs[3] = { &images[0], &images[1], &raster.image };
+			char const* kinds[3] = { "scene", "programs", "raster" };
+			for (unsigned int c1(0); c1 < 3; ++c1)
+			{
+				std::string path(std::string(options.output) + "-" + layoutNames[l] + "-" + kinds[c1] + ".png");
+				FILE* file(fopen(path.c_str(), "wb"));
+				if (!file)
+				{
+					printf("Cannot write %s\n", path.c_str());
+					return 1;
+				}
+				Raster::writePng(file, *outputs[c1]);
+				fclose(file);
+			}
+		}
+	}
+	GLenum error(glGetError());
+
+	printf("Roster: %s, %llu frames drawn through the ring, %llu compared in two layouts, %llu waited for the GPU\n",
+		options.roster, options.frames, checked, ring.waits);
+	printf("%-40s %10s %10s %10s\n", "Comparison", "pixels", "differing", "unmatched");
+	bool passed(error == GL_NO_ERROR);
+	for (Comparison const& a : comparisons)
+	{
+		a.print();
+		passed = passed && a.passed();
+	}
+	if (error != GL_NO_ERROR)printf("GL error 0x%x\n", error);
+	return passed ? 0 : 1;
+}
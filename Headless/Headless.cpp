@@ -0,0 +1,870 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <HexPongCore/Match.h>
+#include <HexPongCore/Netplay.h>
+#include <HexPongCore/Offscreen.h>
+#include <HexPongCore/AI.h>
+#include <HexPongCore/Config.h>
+#include <HexPongCore/PhysicsBatch.h>
+#include <HexPongCore/StateRing.h>
+#include <HexPongCore/StaticMatch.h>
+#include <HexPongCore/Sweep.h>
+#include <HexPongCore/Telemetry.h>
+#include <HexPongCore/Tournament.h>
+
+using namespace Pong;
+
+struct Options
+{
+	unsigned long long frames;
+	char const* roster;
+	unsigned int lanes;
+	bool verify;
+	unsigned long long matches;
+	Tournament::Settings tournament;
+	Sweep::Settings sweep;
+	bool grid;
+	char const* output;
+	char const* telemetry;
+	char const* inspect;
+	bool dispatch;
+	double ccd;
+	bool energy;
+	char const* record;
+	char const* replay;
+	bool snapshot;
+	unsigned int peers;
+	double latency;
+	double loss;
+	unsigned int delay;
+	unsigned int port;
+	char const* render;
+	char const* trace;
+	char const* config;
+	unsigned int side;
+	unsigned int views;
+	unsigned int every;
+
+	Options()
+		:
+		frames(10000000ull),
+		roster("EBBEBB"),
+		lanes(0),
+		verify(false),
+		matches(0),
+		tournament(),
+		sweep(),
+		grid(false),
+		output(nullptr),
+		telemetry(nullptr),
+		inspect(nullptr),
+		dispatch(false),
+		ccd(0),
+		energy(false),
+		record(nullptr),
+		replay(nullptr),
+		snapshot(false),
+		peers(0),
+		latency(60),
+		loss(0.05),
+		delay(2),
+		port(47100),
+		render(nullptr),
+		trace(nullptr),
+		config(nullptr),
+		side(400),
+		views(2),
+		every(1)
+	{
+	}
+	bool parse(int argc, char** argv)
+	{
+		for (int c0(1); c0 < argc; ++c0)
+		{
+			if (!strcmp(argv[c0], "-f") && c0 + 1 < argc)frames = strtoull(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-r") && c0 + 1 < argc)roster = argv[++c0];
+			else if (!strcmp(argv[c0], "-n") && c0 + 1 < argc)lanes = strtoul(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-v"))verify = true;
+			else if (!strcmp(argv[c0], "-d"))dispatch = true;
+			else if (!strcmp(argv[c0], "-c") && c0 + 1 < argc)ccd = atof(argv[++c0]);
+			else if (!strcmp(argv[c0], "-e"))energy = true;
+			else if (!strcmp(argv[c0], "-w") && c0 + 1 < argc)record = argv[++c0];
+			else if (!strcmp(argv[c0], "-P") && c0 + 1 < argc)replay = argv[++c0];
+			else if (!strcmp(argv[c0], "-b"))snapshot = true;
+			else if (!strcmp(argv[c0], "-N") && c0 + 1 < argc)peers = strtoul(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-l") && c0 + 1 < argc)latency = atof(argv[++c0]);
+			else if (!strcmp(argv[c0], "-L") && c0 + 1 < argc)loss = atof(argv[++c0]) / 100;
+			else if (!strcmp(argv[c0], "-D") && c0 + 1 < argc)delay = strtoul(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-o") && c0 + 1 < argc)port = strtoul(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-R") && c0 + 1 < argc)render = argv[++c0];
+			else if (!strcmp(argv[c0], "-T") && c0 + 1 < argc)trace = argv[++c0];
+			else if (!strcmp(argv[c0], "-C") && c0 + 1 < argc)config = argv[++c0];
+			else if (!strcmp(argv[c0], "-S") && c0 + 1 < argc)side = strtoul(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-V") && c0 + 1 < argc)views = strtoul(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-k") && c0 + 1 < argc)every = strtoul(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-t") && c0 + 1 < argc)matches = strtoull(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-p") && c0 + 1 < argc)tournament.points = strtoul(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-j") && c0 + 1 < argc)tournament.threads = strtoul(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-s") && c0 + 1 < argc)tournament.seed = strtoull(argv[++c0], nullptr, 10);
+			else if (!strcmp(argv[c0], "-g") && c0 + 1 < argc)
+			{
+				if (!axis(argv[++c0]))return false;
+			}
+			else if (!strcmp(argv[c0], "-O") && c0 + 1 < argc)output = argv[++c0];
+			else if (!strcmp(argv[c0], "-M") && c0 + 1 < argc)telemetry = argv[++c0];
+			else if (!strcmp(argv[c0], "-Q") && c0 + 1 < argc)inspect = argv[++c0];
+			else return false;
+		}
+		if (!validSides(sides()))
+		{
+			printf("-r %s: %u seats, the arena has 3 to %u sides\n", roster, sides(), maxSides);
+			return false;
+		}
+		if (peers > sides() || port + peers > 65536)return false;
+		//a replay brings its own number of seats, checked once it is open
+		if (!views || views > (replay ? maxSides : sides()) || !side || !every)return false;
+		//the batch lanes, the dispatch comparison and the energy table run on the defaults
+		if (config && (lanes || dispatch || energy || sweeping()))return false;
+		//telemetry comes from Match::step: the single match, -P and -t
+		if (telemetry && (peers || snapshot || energy || dispatch || sweeping() || (lanes && !matches)))return false;
+		for (unsigned int c0(0); c0 < sides(); ++c0)
+			if (!validSeat(roster[c0]))return false;
+		//the batch lanes play S, E and B seats only, in the hexagon like the dispatch comparison
+		if ((sweeping() || (lanes && !matches)) && strchr(roster, PredictiveSeat))return false;
+		if ((dispatch || sweeping() || (lanes && !matches)) && sides() != Hexagon::sides)return false;
+		return true;
+	}
+	//one seat per roster code, and as many sides to the arena
+	unsigned int sides()const
+	{
+		return (unsigned int)strlen(roster);
+	}
+	//-g name=min:max:steps
+	bool axis(char const* _text)
+	{
+		char name[16];
+		Sweep::Axis a;
+		if (sscanf(_text, "%15[A-Za-z0-9]=%lf:%lf:%u", name, &a.min, &a.max, &a.steps) != 4 || !a.steps)
+			return false;
+		if (!strcmp(name, "G"))sweep.G = a;
+		else if (!strcmp(name, "r0"))sweep.r0 = a;
+		else if (!strcmp(name, "ballSpeed"))sweep.ballSpeed = a;
+		else return false;
+		grid = true;
+		return true;
+	}
+	bool sweeping()const
+	{
+		return grid;
+	}
+};
+
+//-C: a tuned match is served again so that it starts at the tuned ballSpeed
+void tune(Options const& _options, Physics& _physics)
+{
+	if (!_options.config)return;
+	_physics.tune(_options.tournament.tuning);
+	_physics.init();
+}
+
+void printLosts(unsigned long long _frames, unsigned long long _points, unsigned long long const* _losts, double _seconds,
+	unsigned int _sides = Hexagon::sides)
+{
+	printf("Frames: %llu in %.3lf s (%.2lf M frames/s)\n", _frames, _seconds, _frames / _seconds * 1e-6);
+	printf("Points: %llu (%.1lf frames/point)\n", _points, _points ? double(_frames) / _points : 0.0);
+	for (unsigned int c0(0); c0 < _sides; ++c0)
+		printf("Player %u Losts: %llu (%.2lf%%)\n", c0, _losts[c0], _points ? 100.0 * _losts[c0] / _points : 0.0);
+}
+
+//starts rendering every _options.every-th frame when -R is given
+//drawn in _physics' arena with its tuning
+bool openRender(Options const& _options, std::unique_ptr<Offscreen>& _offscreen, Physics const& _physics)
+{
+	if (!_options.render)return true;
+	_offscreen.reset(new Offscreen(_options.side, _options.views, _physics.arena.sides, _physics.tuning));
+	if (_offscreen->open(_options.render))return true;
+	printf("Cannot write %s\n", _options.render);
+	return false;
+}
+
+void printRender(Options const& _options, Offscreen* _offscreen, double _seconds)
+{
+	if (!_offscreen)return;
+	_offscreen->close();
+	Raster::Image const& image(_offscreen->renderer.image);
+	printf("Rendered %llu frames of %ux%u to %s: %.1lf frames/s overall, %.2lf ms render + %.2lf ms write per frame on the render thread, simulation waited on a full queue %llu times%s\n",
+		_offscreen->written, image.width, image.height, strcmp(_options.render, "-") ? _options.render : "stdout",
+		_offscreen->written / _seconds, _offscreen->renderSeconds / _offscreen->written * 1e3,
+		_offscreen->writeSeconds / _offscreen->written * 1e3, _offscreen->queue.blocked,
+		_offscreen->failed ? " (write FAILED)" : "");
+}
+
+//-M: starts the drain thread; the caller hands Log::add() rings to its matches
+bool openTelemetry(Options const& _options, Telemetry::Log& _log)
+{
+	if (!_options.telemetry || _log.open(_options.telemetry))return true;
+	printf("Cannot write %s\n", _options.telemetry);
+	return false;
+}
+
+// Finishes the file and reads it back: every loss must be in it, one per
+// point, unless the rings dropped events.
+bool closeTelemetry(Options const& _options, Telemetry::Log& _log, unsigned long long const* _losts, unsigned int _sides)
+{
+	if (!_options.telemetry)return true;
+	_log.close();
+	Telemetry::Reader reader;
+	unsigned long long events(0), losts[maxSides]{ 0 };
+	Telemetry::Event event;
+	if (reader.open(_options.telemetry))
+		while (reader.next(event))
+		{
+			++events;
+			if (event.kind == Telemetry::Loss)losts[event.seat % maxSides]++;
+		}
+	bool same(reader.ended && !_log.failed && events == _log.events &&
+		(_log.dropped || !memcmp(losts, _losts, _sides * sizeof(*losts))));
+	printf("Telemetry: %llu events to %s, %llu bytes (%.1lf bytes/event, %.2lfx smaller than %u-byte records), %llu dropped, read back %s\n",
+		_log.events, _options.telemetry, _log.bytes, _log.events ? double(_log.bytes) / _log.events : 0.0,
+		_log.bytes ? double(_log.events) * Telemetry::Log::raw / _log.bytes : 0.0, Telemetry::Log::raw, _log.dropped,
+		same ? (_log.dropped ? "without the loss check" : "matches") : "DIFFERS");
+	return same;
+}
+
+int runSingle(Options const& _options)
+{
+	unsigned int sides(_options.sides());
+	Match match(sides);
+	std::unique_ptr<Player> seats[maxSides];
+	for (unsigned int c0(0); c0 < sides; ++c0)
+	{
+		seats[c0].reset(createPlayer(SeatKind(_options.roster[c0]), &match.physics, c0));
+		match.players[c0] = seats[c0].get();
+	}
+	tune(_options, match.physics);
+
+	if (_options.ccd > 0)
+	{
+		match.physics.ccd.enabled = true;
+		match.physics.ccd.tick = _options.ccd * match.physics.tuning.dt;
+		match.physics.ccd.maxStep = match.physics.ccd.tick;
+	}
+
+	Replay::Writer recorder;
+	if (_options.record)
+	{
+		if (!recorder.open(_options.record, match.physics, _options.roster))
+		{
+			printf("Cannot write %s\n", _options.record);
+			return 1;
+		}
+		match.recorder = &recorder;
+	}
+	std::unique_ptr<Offscreen> offscreen;
+	if (!openRender(_options, offscreen, match.physics))return 1;
+	Telemetry::Log telemetry;
+	if (!openTelemetry(_options, telemetry))return 1;
+	if (_options.telemetry)match.telemetry = telemetry.add();
+
+	unsigned long long escapes(0), substeps(0);
+	auto t0(std::chrono::steady_clock::now());
+	for (unsigned long long c0(0); c0 < _options.frames; ++c0)
+	{
+		match.step();
+		escapes += !match.physics.arena.inside(match.physics.r, 1e-9);
+		substeps += match.physics.substeps;
+		if (offscreen && c0 % _options.every == 0)offscreen->push(match.physics, c0 / _options.every);
+	}
+	if (offscreen)offscreen->close();
+	double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+	if (!recorder.close(match.physics))
+	{
+		printf("Cannot write %s\n", _options.record);
+		return 1;
+	}
+	printRender(_options, offscreen.get(), seconds);
+
+	unsigned long long losts[maxSides];
+	for (unsigned int c0(0); c0 < sides; ++c0)
+		losts[c0] = match.losts[c0];
+	printf("Roster: %s\n", _options.roster);
+	if (_options.ccd > 0)
+		printf("CCD: tick %.4lf (%.2lf dt), %.2lf substeps/tick, %.2lf simulated s per wall s\n",
+			match.physics.ccd.tick, _options.ccd, double(substeps) / match.frames,
+			match.frames * match.physics.ccd.tick / seconds);
+	else
+		printf("Discrete: tick %.4lf, %.2lf simulated s per wall s\n", match.physics.tuning.dt,
+			match.frames * match.physics.tuning.dt / seconds);
+	printLosts(match.frames, match.points, losts, seconds, sides);
+	printf("Frames with the ball outside the arena: %llu\n", escapes);
+	return closeTelemetry(_options, telemetry, losts, sides) ? 0 : 1;
+}
+
+int runReplay(Options const& _options)
+{
+	Replay::Reader reader;
+	if (!reader.open(_options.replay))
+	{
+		printf("Cannot read replay %s\n", _options.replay);
+		return 1;
+	}
+	unsigned int sides(reader.sides);
+	Match match(sides);
+	for (unsigned int c0(0); c0 < sides; ++c0)
+		match.players[c0] = reader.seats + c0;
+	reader.start(match.physics);
+	if (_options.views > sides)
+	{
+		printf("-V %u: the replay has %u seats\n", _options.views, sides);
+		return 1;
+	}
+	std::unique_ptr<Offscreen> offscreen;
+	if (!openRender(_options, offscreen, match.physics))return 1;
+	Telemetry::Log telemetry;
+	if (!openTelemetry(_options, telemetry))return 1;
+	if (_options.telemetry)match.telemetry = telemetry.add();
+
+	auto t0(std::chrono::steady_clock::now());
+	while (reader.next(match.physics))
+	{
+		match.step();
+		if (offscreen && (match.frames - 1) % _options.every == 0)
+			offscreen->push(match.physics, (match.frames - 1) / _options.every);
+	}
+	if (offscreen)offscreen->close();
+	double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+	printRender(_options, offscreen.get(), seconds);
+
+	unsigned long long losts[maxSides];
+	for (unsigned int c0(0); c0 < sides; ++c0)
+		losts[c0] = match.losts[c0];
+	bool same(reader.recorded == match.frames && reader.final == Replay::State::capture(match.physics));
+	printf("Replay: %s, roster %s\n", _options.replay, reader.roster);
+	printLosts(match.frames, match.points, losts, seconds, sides);
+	printf("Final state %s the recording (%llu of %llu frames)\n",
+		same ? "matches" : "DIFFERS from", match.frames, reader.recorded);
+	same = closeTelemetry(_options, telemetry, losts, sides) && same;
+	return same ? 0 : 1;
+}
+
+int runBatch(Options const& _options)
+{
+	SeatKind kinds[6];
+	for (unsigned int c0(0); c0 < 6; ++c0)
+		kinds[c0] = SeatKind(_options.roster[c0]);
+	unsigned int n(_options.lanes);
+	PhysicsBatch batch(n, kinds);
+	for (unsigned int c0(0); c0 < n; ++c0)
+		batch.init(c0, c0 % 6);
+
+	std::vector<Match> matches(_options.verify ? n : 0);
+	std::vector<std::unique_ptr<Player>> seats;
+	for (unsigned int c0(0); c0 < matches.size(); ++c0)
+	{
+		matches[c0].physics.lostPlayer = c0 % 6;
+		matches[c0].physics.init();
+		for (unsigned int c1(0); c1 < 6; ++c1)
+		{
+			seats.emplace_back(createPlayer(kinds[c1], &matches[c0].physics, c1));
+			matches[c0].players[c1] = seats.back().get();
+		}
+	}
+
+	unsigned long long points(0);
+	unsigned long long losts[6]{ 0 };
+	unsigned long long mismatches(0);
+	auto t0(std::chrono::steady_clock::now());
+	for (unsigned long long c0(0); c0 < _options.frames; ++c0)
+	{
+		batch.update();
+		for (unsigned int c1(0); c1 < n; ++c1)
+			if (batch.ended[c1])
+			{
+				losts[batch.lostPlayer[c1]]++;
+				++points;
+				batch.ended[c1] = false;
+				batch.init(c1);
+			}
+		for (unsigned int c1(0); c1 < matches.size(); ++c1)
+		{
+			Physics& physics(matches[c1].physics);
+			matches[c1].step();
+			bool same(physics.r[0] == batch.rx[c1] && physics.r[1] == batch.ry[c1] &&
+				physics.v[0] == batch.vx[c1] && physics.v[1] == batch.vy[c1] &&
+				physics.lostPlayer == batch.lostPlayer[c1]);
+			for (unsigned int c2(0); c2 < 6; ++c2)
+				same = same && physics.offsets[c2] == batch.offsets[c2][c1];
+			if (!same && !mismatches++)
+				printf("Lane %u diverged at frame %llu\n", c1, c0);
+		}
+	}
+	double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+
+	printf("Roster: %s, %u lanes\n", _options.roster, n);
+	printLosts(_options.frames * n, points, losts, seconds);
+	if (_options.verify)
+		printf("Verify against Physics::update: %s (%llu mismatches)\n", mismatches ? "FAILED" : "passed", mismatches);
+	return mismatches ? 1 : 0;
+}
+
+// -g: every grid point played on PhysicsBatch lanes over all cores, one
+// summary row per point, or a CSV with the histograms to -O
+int runSweep(Options const& _options)
+{
+	Sweep::Settings settings(_options.sweep);
+	for (unsigned int c0(0); c0 < 6; ++c0)
+		settings.seats[c0] = SeatKind(_options.roster[c0]);
+	settings.frames = _options.frames;
+	if (_options.lanes)settings.lanes = _options.lanes;
+	settings.threads = _options.tournament.threads;
+	settings.verify = _options.verify;
+	Sweep sweep(settings);
+
+	auto t0(std::chrono::steady_clock::now());
+	sweep.run();
+	double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+
+	unsigned long long frames(sweep.points.size() * settings.frames);
+	printf("Roster: %s, %zu grid points of %llu frames, %u lanes per batch\n",
+		_options.roster, sweep.points.size(), settings.frames, settings.lanes);
+	printf("%.3lf s, %.2lf M lane frames/s, %.1lf points/s, %llu steals\n",
+		seconds, frames / seconds * 1e-6, sweep.points.size() / seconds, sweep.steals);
+	if (_options.output)
+	{
+		if (!sweep.write(_options.output))
+		{
+			printf("Cannot write %s\n", _options.output);
+			return 1;
+		}
+		printf("Wrote %s\n", _options.output);
+	}
+	else
+	{
+		printf("%9s %9s %9s %7s %10s %9s %9s %8s %7s   losts per seat (%%)\n",
+			"G", "r0", "ballSpeed", "points", "rally p50", "rally p99", "bounces", "ita", "ita sd");
+		for (Sweep::Point const& a : sweep.points)
+		{
+			printf("%9.4lf %9.4lf %9.4lf %7llu %10.1lf %9.1lf %9.2lf %8.3lf %7.3lf  ",
+				a.tuning.G, a.tuning.r0, a.tuning.ballSpeed, a.points, a.rally.quantile(0.5), a.rally.quantile(0.99),
+				a.bounces.mean(), a.ita.mean(), a.ita.deviation());
+			for (unsigned int c0(0); c0 < 6; ++c0)
+				printf(" %5.1lf", a.points ? 100.0 * a.losts[c0] / a.points : 0.0);
+			printf("\n");
+		}
+	}
+	if (settings.verify)
+		printf("Verify against Physics::update: %s (%llu mismatches)\n",
+			sweep.mismatches ? "FAILED" : "passed", sweep.mismatches.load());
+	return sweep.mismatches ? 1 : 0;
+}
+
+// Free flight under the central force only (no borders, where bounces reset
+// the speed anyway): worst relative energy error over one pass of a serve-speed
+// ball across the arena, per integrator, step size and impact parameter b.
+// b = 0.03 crosses r0, where the force is discontinuous.
+int runEnergy()
+{
+	using namespace Math;
+	char const* names[4] = { "Taylor", "VelocityVerlet", "Leapfrog", "RK4" };
+	double scales[] = { 1.0 / 16, 0.25, 1, 4, 16 };
+	double impacts[] = { 0.3, 0.15, 0.03 };
+	constexpr double duration = 0.8;
+	constexpr double tolerance = 1e-3;
+	printf("Energy drift over %.1lf s from (-0.9, b) at (%.3lf, 0)\n", duration, ballSpeed);
+	printf("%-15s %5s", "h / dt", "b");
+	for (double scale : scales)printf("  %9g", scale);
+	printf("  ns/step  largest h with drift < %.0e\n", tolerance);
+	for (unsigned int c0(0); c0 < 4; ++c0)
+		for (double b : impacts)
+		{
+			Integrator integrator((Integrator)c0);
+			printf("%-15s %5.2lf", names[c0], b);
+			double best(0), ns(0);
+			for (double scale : scales)
+			{
+				double h(scale * dt);
+				vec2<double> r{ -0.9, b }, v{ ballSpeed, 0 };
+				double e0(Physics::energy(r, v)), drift(0);
+				unsigned long long steps((unsigned long long)(duration / h));
+				auto t0(std::chrono::steady_clock::now());
+				for (unsigned long long c1(0); c1 < steps; ++c1)
+				{
+					r = Physics::propagate(integrator, r, v, h);
+					double e(fabs((Physics::energy(r, v) - e0) / e0));
+					if (!(e <= drift))drift = e;
+				}
+				double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+				if (scale == 1)ns = seconds / steps * 1e9;
+				if (drift < tolerance)best = scale;
+				printf("  %9.1e", drift);
+			}
+			printf("  %7.1lf  %g dt\n", ns, best);
+		}
+	return 0;
+}
+
+int runDispatch(Options const& _options)
+{
+	Match match;
+	EasyAI easy[2]{ {&match.physics, 0}, {&match.physics, 3} };
+	BrutalAI brutal[4]{ {&match.physics, 1}, {&match.physics, 2}, {&match.physics, 4}, {&match.physics, 5} };
+	Player* players[6]{ easy, brutal, brutal + 1, easy + 1, brutal + 2, brutal + 3 };
+	for (unsigned int c0(0); c0 < 6; ++c0)
+		match.players[c0] = players[c0];
+	StaticMatch<EasyAI, BrutalAI, BrutalAI, EasyAI, BrutalAI, BrutalAI> fixed;
+
+	auto t0(std::chrono::steady_clock::now());
+	match.run(_options.frames);
+	auto t1(std::chrono::steady_clock::now());
+	fixed.run(_options.frames);
+	auto t2(std::chrono::steady_clock::now());
+	double tVirtual(std::chrono::duration<double>(t1 - t0).count());
+	double tStatic(std::chrono::duration<double>(t2 - t1).count());
+
+	bool same(match.physics.r[0] == fixed.physics.r[0] && match.physics.r[1] == fixed.physics.r[1]);
+	for (unsigned int c0(0); c0 < 6; ++c0)
+		same = same && match.losts[c0] == fixed.losts[c0];
+	printf("Roster: EBBEBB, %llu frames\n", _options.frames);
+	printf("Virtual Player::update : %6.2lf ns/frame\n", tVirtual / _options.frames * 1e9);
+	printf("StaticMatch            : %6.2lf ns/frame (%.2lfx)\n", tStatic / _options.frames * 1e9, tVirtual / tStatic);
+	printf("Results %s\n", same ? "identical" : "DIFFER");
+	return same ? 0 : 1;
+}
+
+int runSnapshot(Options const& _options)
+{
+	unsigned int sides(_options.sides());
+	Match match(sides);
+	std::unique_ptr<Player> seats[maxSides];
+	for (unsigned int c0(0); c0 < sides; ++c0)
+	{
+		seats[c0].reset(createPlayer(SeatKind(_options.roster[c0]), &match.physics, c0));
+		match.players[c0] = seats[c0].get();
+	}
+	tune(_options, match.physics);
+	constexpr unsigned int ringSize = 256;
+	StateRing<ringSize> ring;
+
+	unsigned long long copies(_options.frames);
+	volatile unsigned int sink(0);
+	auto t0(std::chrono::steady_clock::now());
+	for (unsigned long long c0(0); c0 < copies; ++c0)
+	{
+		ring.save(c0, match.physics);
+		match.physics.inputs[0].pos = double(c0 & 7);
+	}
+	auto t1(std::chrono::steady_clock::now());
+	for (unsigned long long c0(0); c0 < copies; ++c0)
+	{
+		match.physics.restore(ring.states[c0 & (ringSize - 1)]);
+		sink = sink + match.physics.lostPlayer;
+	}
+	auto t2(std::chrono::steady_clock::now());
+	double tSave(std::chrono::duration<double>(t1 - t0).count());
+	double tRestore(std::chrono::duration<double>(t2 - t1).count());
+	//copy() moves only the arena's seats
+	size_t bytes(sizeof(PhysicsState) - (maxSides - sides) * (sizeof(double) + sizeof(Input)));
+	printf("PhysicsState: %u bytes, %u of them for %u seats, ring of %u\n", unsigned(sizeof(PhysicsState)),
+		unsigned(bytes), sides, ringSize);
+	printf("save    : %6.2lf ns (%.1lf M/s, %.2lf GB/s)\n", tSave / copies * 1e9,
+		copies / tSave * 1e-6, copies * bytes / tSave * 1e-9);
+	printf("restore : %6.2lf ns (%.1lf M/s, %.2lf GB/s)\n", tRestore / copies * 1e9,
+		copies / tRestore * 1e-6, copies * bytes / tRestore * 1e-9);
+
+	//every frame: rewind depth frames, re-simulate them and check that the
+	//state comes out bit for bit the same
+	match.physics.lostPlayer = 0;
+	match.physics.init();
+	ring.clear();
+	constexpr unsigned int rounds = 4096;
+	double budget(1 / frameRate);
+	unsigned int affordable(0);
+	unsigned long long mismatches(0);
+	printf("%5s  %10s  %9s  %s\n", "depth", "us/rollback", "ns/frame", "share of a frame");
+	for (unsigned int depth(1); depth < ringSize; depth *= 2)
+	{
+		unsigned long long frame(0);
+		ring.clear();
+		for (; frame < depth; ++frame)
+		{
+			ring.save(frame, match.physics);
+			match.step();
+		}
+		double seconds(0);
+		for (unsigned int c0(0); c0 < rounds; ++c0)
+		{
+			ring.save(frame, match.physics);
+			match.step();
+			++frame;
+			PhysicsState now(match.physics.state());
+			auto t3(std::chrono::steady_clock::now());
+			ring.rewind(frame - depth, match.physics);
+			for (unsigned long long c1(frame - depth); c1 < frame; ++c1)
+			{
+				if (c1 != frame - depth)ring.save(c1, match.physics);
+				match.step();
+			}
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t3).count();
+			mismatches += !now.same(match.physics, sides);
+		}
+		double rollback(seconds / rounds);
+		if (rollback < budget)affordable = unsigned(budget / (rollback / depth));
+		printf("%5u  %10.2lf  %9.1lf  %6.3lf%%\n", depth, rollback * 1e6, rollback / depth * 1e9, 100 * rollback / budget);
+	}
+	printf("Re-simulated frames that fit in one %.1lf ms frame: ~%u\n", budget * 1e3, affordable);
+	printf("Rollbacks that did not reproduce the state: %llu\n", mismatches);
+	return mismatches ? 1 : 0;
+}
+
+int runNetplay(Options const& _options)
+{
+	using namespace Netplay;
+	unsigned int peers(_options.peers);
+	unsigned long long frames(_options.frames);
+	unsigned int latency((unsigned int)(_options.latency * _options.tournament.tuning.frameRate / 1000 + 0.5));
+	std::vector<std::unique_ptr<Physics>> physics;
+	std::vector<std::unique_ptr<Session>> sessions;
+	std::vector<std::unique_ptr<Player>> seats;
+	std::vector<std::unique_ptr<Link>> links;
+	unsigned int sides(_options.sides());
+	unsigned int owners[maxSides];
+	Address addresses[maxSides];
+	for (unsigned int c0(0); c0 < sides; ++c0)
+		owners[c0] = c0 % peers;
+	for (unsigned int c0(0); c0 < peers; ++c0)
+	{
+		addresses[c0].ip = 0x7f000001;
+		addresses[c0].port = (unsigned short)(_options.port + c0);
+	}
+	for (unsigned int c0(0); c0 < peers; ++c0)
+	{
+		physics.emplace_back(new Physics(sides));
+		tune(_options, *physics.back());
+		Player* local[maxSides];
+		for (unsigned int c1(0); c1 < sides; ++c1)
+		{
+			seats.emplace_back(createPlayer(SeatKind(_options.roster[c1]), physics.back().get(), c1));
+			local[c1] = seats.back().get();
+		}
+		links.emplace_back(new Link(_options.loss, latency, latency / 2, c0 + 1));
+		sessions.emplace_back(new Session(physics.back().get(), _options.delay));
+		sessions.back()->link = links.back().get();
+		if (!sessions.back()->open(c0, peers, owners, addresses, local))
+		{
+			printf("Cannot open peer %u on 127.0.0.1:%u\n", c0, addresses[c0].port);
+			return 1;
+		}
+	}
+
+	unsigned long long ticks(0), limit(frames * 64 + 100000);
+	auto t0(std::chrono::steady_clock::now());
+	for (bool done(false); !done && ticks < limit; ++ticks)
+	{
+		done = true;
+		for (unsigned int c0(0); c0 < peers; ++c0)
+		{
+			sessions[c0]->advance(frames);
+			done = done && sessions[c0]->settled == frames;
+		}
+	}
+	double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+
+	printf("%u peers over localhost, input delay %u, latency %.0lf ms (%u ticks + jitter), loss %.1lf%%\n",
+		peers, _options.delay, _options.latency, latency, _options.loss * 100);
+	printf("Peer  Frames  Stalls  Rollbacks  Resim/frame  Resim us/frame  Packets  Bytes/packet  Dropped\n");
+	bool same(true);
+	for (unsigned int c0(0); c0 < peers; ++c0)
+	{
+		Session const& a(*sessions[c0]);
+		printf("%4u  %6llu  %6llu  %9llu  %11.2lf  %14.2lf  %7llu  %12.1lf  %7llu\n", c0, a.frame, a.stalls,
+			a.rollbacks, double(a.resimulated) / a.frame, a.resimulationSeconds / a.frame * 1e6,
+			a.packetsSent, double(a.bytesSent) / a.packetsSent, links[c0]->dropped);
+		same = same && a.settled == frames &&
+			physics[c0]->same(*physics[0], sides) &&
+			!memcmp(a.losts, sessions[0]->losts, sizeof(a.losts));
+	}
+	printf("%llu ticks in %.3lf s\n", ticks, seconds);
+	unsigned long long points(0);
+	for (unsigned int c0(0); c0 < sides; ++c0)points += sessions[0]->losts[c0];
+	printLosts(frames, points, sessions[0]->losts, seconds, sides);
+	printf("Peers %s after %llu frames\n", same ? "agree" : "DIVERGED", frames);
+	return same ? 0 : 1;
+}
+
+int runTournament(Options const& _options)
+{
+	unsigned int sides(_options.sides());
+	std::vector<Entrant> roster;
+	for (unsigned int c0(0); c0 < sides; ++c0)
+	{
+		SeatKind kind(SeatKind(_options.roster[c0]));
+		char name[16];
+		snprintf(name, sizeof(name), "%c%u", _options.roster[c0], c0);
+		roster.push_back({ name, [kind](Physics* _physics, unsigned int _id)
+			{
+				return createPlayer(kind, _physics, _id);
+			} });
+	}
+	Tournament tournament(roster);
+	Tournament::Settings settings(_options.tournament);
+	settings.matches = _options.matches;
+	settings.sides = sides;
+	Telemetry::Log telemetry;
+	if (!openTelemetry(_options, telemetry))return 1;
+	if (_options.telemetry)settings.telemetry = &telemetry;
+
+	auto t0(std::chrono::steady_clock::now());
+	Tournament::Tally total(tournament.run(settings));
+	double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+
+	printf("Roster: %s, %llu matches of %u points, seed %llu\n", _options.roster, total.matches, settings.points, settings.seed);
+	printf("%.1lf matches/s, %llu steals\n", total.matches / seconds, tournament.steals);
+	printLosts(total.frames, total.points, total.seatLosts, seconds, sides);
+	std::vector<unsigned int> ranking(roster.size());
+	for (unsigned int c0(0); c0 < ranking.size(); ++c0)ranking[c0] = c0;
+	std::stable_sort(ranking.begin(), ranking.end(), [&total](unsigned int a, unsigned int b)
+		{
+			return total.rating(a) < total.rating(b);
+		});
+	printf("Rank  Entrant  Losts  Rating (losses per point x%u, lower is better)\n", sides);
+	for (unsigned int c0(0); c0 < ranking.size(); ++c0)
+		printf("%4u  %-7s  %5llu  %.3lf\n", c0 + 1, roster[ranking[c0]].name.c_str(),
+			total.losts[ranking[c0]], total.rating(ranking[c0]));
+	//match 0 played again, the same match with the same serves, into -w
+	Tournament::Tally scratch(unsigned(roster.size()), sides);
+	if (_options.record && !tournament.play(0, settings, scratch, nullptr, _options.record))
+	{
+		printf("Cannot write %s\n", _options.record);
+		return 1;
+	}
+	if (_options.record)printf("Match 0: %llu frames to %s\n", scratch.frames, _options.record);
+	return closeTelemetry(_options, telemetry, total.seatLosts, sides) ? 0 : 1;
+}
+
+// -Q: what a telemetry file holds; -O converts it to one CSV row per event
+int runInspect(Options const& _options)
+{
+	Telemetry::Reader reader;
+	if (!reader.open(_options.inspect))
+	{
+		printf("Cannot read telemetry %s\n", _options.inspect);
+		return 1;
+	}
+	FILE* csv(nullptr);
+	if (_options.output)
+	{
+		csv = fopen(_options.output, "w");
+		if (!csv)
+		{
+			printf("Cannot write %s\n", _options.output);
+			return 1;
+		}
+		fprintf(csv, "match,frame,rally,seat,kind,offset,vInX,vInY,vOutX,vOutY\n");
+	}
+	unsigned long long events(0), bounces(0), losts[maxSides]{ 0 }, points(0), matches(0), match(0);
+	double rallies(0), offsets(0);
+	//the highest seat seen, plus one
+	unsigned int seats(0);
+	Telemetry::Event a;
+	while (reader.next(a))
+	{
+		if (!events++ || a.match != match)++matches;
+		match = a.match;
+		if (a.seat % maxSides >= seats)seats = a.seat % maxSides + 1;
+		if (a.kind == Telemetry::Loss)
+		{
+			losts[a.seat % maxSides]++;
+			++points;
+			rallies += a.rally;
+		}
+		else
+		{
+			++bounces;
+			offsets += fabs(a.offset);
+		}
+		if (csv)
+			fprintf(csv, "%llu,%llu,%u,%u,%s,%.17g,%.17g,%.17g,%.17g,%.17g\n", a.match, a.frame, a.rally, a.seat,
+				a.kind == Telemetry::Loss ? "loss" : "bounce", a.offset, a.vIn[0], a.vIn[1], a.vOut[0], a.vOut[1]);
+	}
+	if (csv && fclose(csv))printf("Cannot write %s\n", _options.output);
+	printf("Telemetry: %s, %llu events over %llu match runs, %llu dropped while recording%s\n", _options.inspect,
+		events, matches, reader.dropped, reader.ended ? "" : " (TRUNCATED)");
+	printf("Bounces: %llu, mean |offset| %.4lf\n", bounces, bounces ? offsets / bounces : 0.0);
+	printf("Points: %llu, mean rally %.1lf frames\n", points, points ? rallies / points : 0.0);
+	for (unsigned int c0(0); c0 < seats; ++c0)
+		printf("Player %u Losts: %llu (%.2lf%%)\n", c0, losts[c0], points ? 100.0 * losts[c0] / points : 0.0);
+	return reader.ended ? 0 : 1;
+}
+
+int run(Options const& _options)
+{
+	if (_options.inspect)return runInspect(_options);
+	if (_options.replay)return runReplay(_options);
+	if (_options.peers)return runNetplay(_options);
+	if (_options.snapshot)return runSnapshot(_options);
+	if (_options.energy)return runEnergy();
+	if (_options.dispatch)return runDispatch(_options);
+	if (_options.matches)return runTournament(_options);
+	if (_options.sweeping())return runSweep(_options);
+	if (_options.lanes)return runBatch(_options);
+	return runSingle(_options);
+}
+
+int main(int argc, char** argv)
+{
+	Options options;
+	if (!options.parse(argc, argv))
+	{
+		printf("Usage: Headless [-f frames] [-r roster] [-n lanes] [-v] [-d] [-c ticks] [-e] [-w replay] [-P replay] [-b] [-N peers [-l ms] [-L loss%%] [-D delay] [-o port]] [-R out [-S side] [-V views] [-k every]] [-T trace.json] [-C config] [-t matches [-p points] [-j threads] [-s seed]] [-g name=min:max:steps... [-O out.csv]] [-M telemetry] [-Q telemetry [-O out.csv]]\n"
+			"  -r  3 to 32 seat codes of S(top), E(asyAI), B(rutalAI), P(redictiveAI), one per\n"
+			"      side of the arena (6 by default, the hexagon; -n, -g and -d need 6, and\n"
+			"      -n and -g play no P seats)\n"
+			"  -n  step that many matches in lockstep with PhysicsBatch\n"
+			"  -v  check every batch lane against Physics::update\n"
+			"  -c  continuous collision with a tick of that many dt\n"
+			"  -w  record the single-match run, or match 0 of -t with its serves as keyframes,\n"
+			"      to a replay file\n"
+			"  -P  re-simulate a replay file at full speed and check its final state\n"
+			"  -b  PhysicsState save/restore rate and rollback cost by depth\n"
+			"  -N  rollback netplay between that many in-process peers over UDP on localhost,\n"
+			"      seat c owned by peer c %% peers, with simulated one-way latency and loss\n"
+			"  -R  rasterize the single match or replay on a render thread: - for raw RGBA on\n"
+			"      stdout, a printf pattern (f%%06llu.png) for numbered PNG/raw files, else one\n"
+			"      raw RGBA file; -S view side in pixels, -V views (1: seat 0, 2: seat 0 and the\n"
+			"      one opposite, more: seats 0 on, up to one per seat), -k every k-th frame\n"
+			"  -T  report probe timings (p50/p99/max) and write a Chrome trace; needs a build\n"
+			"      with HEXPONG_PROBES defined\n"
+			"  -C  G, r0, playerSpeed... from a config file (see HexPongCore/Config.h) for the\n"
+			"      single match, -b, -N and -t\n"
+			"  -e  energy drift of each integrator against step size\n"
+			"  -d  compare virtual and compile-time seat dispatch on EBBEBB\n"
+			"  -t  play a tournament over all seatings of the roster on all cores\n"
+			"  -g  sweep G, r0 or ballSpeed over steps values from min to max (repeat for a grid),\n"
+			"      -f frames per grid point, one PhysicsBatch lane per point, -n lanes per batch,\n"
+			"      -j threads, -v to check the lanes; -O writes per-point losses and rally,\n"
+			"      bounce and ita histograms as CSV instead of printing a table\n"
+			"  -M  log every bounce and loss of the single match, -P or -t to a compressed\n"
+			"      columnar file (see HexPongCore/Telemetry.h) and check it after the run\n"
+			"  -Q  summarize a telemetry file; -O converts it to CSV\n");
+		return 1;
+	}
+	std::string error;
+	if (options.config && !Config::load(options.config, options.tournament.tuning, error))
+	{
+		printf("%s: %s\n", options.config, error.c_str());
+		return 1;
+	}
+	int result(run(options));
+	if (options.trace)
+	{
+		Probe::print(stdout);
+		if (!Probe::writeTrace(options.trace))printf("Cannot write %s\n", options.trace);
+	}
+	return result;
+}
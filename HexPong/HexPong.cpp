@@ -1,236 +1,23 @@
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+//winsock2.h must come before anything that includes windows.h
+#include <HexPongCore/Netplay.h>
 #include <GL/_Window.h>
 #include <_Time.h>
+#include <memory>
 #include <random>
+#include <HexPongCore/Physics.h>
+#include <HexPongCore/AI.h>
+#include <HexPongCore/Config.h>
+#include <HexPongCore/FixedStep.h>
+#include <HexPongCore/Replay.h>
+#include <HexPongCore/Telemetry.h>
+#include <HexPong/Scene.h>
 
 namespace OpenGL
 {
-	struct Color
-	{
-		float r, g, b;
-	};
-	constexpr Color red = { 1.f, 0.f, 0.f };
-	constexpr Color orange = { 1.f, 127.f / 255.f, 0.f };
-	constexpr Color yellow = { 1.f, 1.f, 0.f };
-	constexpr Color green = { 0.f, 1.f, 0.f };
-	constexpr Color cyan = { 0.f, 1.f, 1.f };
-	constexpr Color blue = { 0.f, 0.f, 1.f };
-	constexpr Color purple = { 127.f / 255.f, 0.f, 1.f };
-
-	constexpr double windowSize = 800;
-	constexpr double scale = 0.9;
-	constexpr double playerW = 0.2;
-	constexpr double playerH = 0.05;
-	constexpr double playerWHalf = playerW / 2;
-	constexpr double frameRate = 80;
-	constexpr double dt = 144 * 0.005 / frameRate;
-	constexpr double dt2 = dt * dt * 0.5;
-	constexpr double G = 0.3;
-	constexpr double r0 = 0.1;
-	constexpr double r03 = r0 * r0 * r0;
-	constexpr double leftLimit = playerW - 1;
-	constexpr double rightLimit = 1 - playerW;
-	constexpr double playerSpeed = 2.0;
-	constexpr double ballSpeed = playerSpeed * 0.9 / rightLimit;
-
-	enum Movement
-	{
-		Stop = 0,
-		Left = 1,
-		Right = 2,
-	};
-	struct Input
-	{
-		Movement move;
-		double pos;
-
-		Input()
-			:
-			move(Stop),
-			pos(0)
-		{
-		}
-		virtual double update(Movement _move)
-		{
-			switch (move = _move)
-			{
-			case Left:
-				if (pos > leftLimit)
-				{
-					double tp(pos - playerSpeed * dt);
-					pos = tp < leftLimit ? leftLimit : tp;
-				}
-				break;
-			case Right:
-				if (pos < rightLimit)
-				{
-					double tp(pos + playerSpeed * dt);
-					pos = tp > rightLimit ? rightLimit : tp;
-				}
-				break;
-			}
-			return pos;
-		}
-	};
-
-	struct Player
-	{
-		virtual Movement update()
-		{
-			return Stop;
-		};
-	};
-	struct Physics
-	{
-		struct LineSegment
-		{
-			using vec2 = Math::vec2<double>;
-			struct Intersection
-			{
-				using vec2 = Math::vec2<double>;
-
-				bool intersected;
-				double t1, t2;
-				vec2 point;
-				Intersection()
-					:
-					intersected(false),
-					t1(0),
-					t2(0),
-					point{ 0 }
-				{
-				}
-			};
-
-			vec2 A, B;
-
-			LineSegment() = default;
-			LineSegment(vec2 _A, vec2 _B)
-				:
-				A(_A),
-				B(_B)
-			{
-
-			}
-			Intersection intersect(LineSegment b)
-			{
-				Intersection r;
-				//todo: pre-test
-				double l1((B - A).length()), l2((b.B - b.A).length());
-				vec2 k1((B - A) / l1), k2((b.B - b.A) / l2);
-				vec2 d(A - b.A);
-				double s(k2[0] * k1[1] - k1[0] * k2[1]);
-				if (s == 0)
-				{
-					r.intersected = false;
-					return r;
-				}
-				r.t1 = (d[0] * k2[1] - k2[0] * d[1]) / s;
-				r.t2 = (d[0] * k1[1] - k1[0] * d[1]) / s;
-				r.point = (A + k1 * r.t1 + b.A + k2 * r.t2) / 2;
-				if (r.t1 < 0 || r.t1 > l1 || r.t2 < 0 || r.t2 > l2)
-					r.intersected = false;
-				else
-					r.intersected = true;
-				return r;
-			}
-		};
-		LineSegment lines[6];
-		Math::vec2<double> r;
-		Math::vec2<double> v;
-		double offsets[6];
-		Input inputs[6];
-		LineSegment::Intersection its[6];
-		unsigned int lostPlayer;
-		bool ended;
-
-		Physics()
-			:
-			r{ 0.17, 0 },
-			v{ 0, -1.2 * ballSpeed },
-			offsets{ 0 },
-			its{},
-			lostPlayer(0),
-			ended(false)
-		{
-			init();
-			double h = sqrt(3) / 2;
-
-			Math::vec2<double> vertices[6];
-
-			vertices[0] = { -0.5, -h };
-			vertices[1] = { 0.5, -h };
-			vertices[2] = { 1, 0 };
-			vertices[3] = { 0.5, h };
-			vertices[4] = { -0.5, h };
-			vertices[5] = { -1, 0 };
-			for (unsigned int c0(0); c0 < 6; ++c0)
-			{
-				lines[c0].A = vertices[c0];
-				lines[c0].B = vertices[(c0 + 1) % 6];
-			}
-		}
-		void init()
-		{
-			double theta = lostPlayer * Math::Pi / 3;
-			r = Math::vec2<double>{ 0.3 * sin(theta), -0.3 * cos(theta) };
-			v = Math::vec2<double>{ 1 * ballSpeed * sin(theta), -1 * ballSpeed * cos(theta) };
-			for (unsigned int c0(0); c0 < 6; ++c0)
-				inputs[c0].pos = 0;
-			for (unsigned int c0(0); c0 < 6; ++c0)
-				offsets[c0] = inputs[c0].update(Stop);
-		}
-		void update(Player** players)
-		{
-			using namespace Math;
-			double rr(r.length());
-			vec2<double> a;
-			if (rr > r0)a = r * (-G / pow(rr, 3));
-			else a = r * (2 * G / pow(rr, 3));
-			vec2<double> r1 = r + v * dt + a * dt2;
-			v += a * dt;
-
-			bool flag(true);
-			LineSegment dr(r, r1);
-			for (unsigned int c0(0); c0 < 6; ++c0)
-				its[c0] = dr.intersect(lines[c0]);
-			for (unsigned int c0(0); c0 < 6; ++c0)
-				offsets[c0] = inputs[c0].update(players[c0]->update());
-			for (unsigned int c0(0); c0 < 6; ++c0)
-			{
-				if (its[c0].intersected)
-				{
-					double offset(its[c0].t2 - (offsets[c0] + 1) / 2);
-					if (abs(offset) < playerWHalf)
-					{
-						double theta((Math::Pi * c0) / 3);
-						vec2<double> tau{ cos(theta), sin(theta) };
-						vec2<double> n{ -sin(theta), cos(theta) };
-
-						double ita(offset / playerWHalf);
-						ita = ita * ita / 2;
-						vec2<double> v1(n);
-						if (offset >= 0)v1 += ita * tau;
-						else v1 -= ita * tau;
-
-						v = v1.normalize();
-						r = its[c0].point + v * (ballSpeed * dt - its[c0].t1);
-						v *= ballSpeed;
-						flag = false;
-					}
-					else
-					{
-						lostPlayer = c0;
-						ended = true;
-						printf("Player %u lost!\n", c0);
-					}
-					break;
-				}
-			}
-			if (flag)r = r1;
-		}
-
-	};
+	using namespace Pong;
 
 	struct RealPlayer0 :Player
 	{
@@ -273,102 +60,26 @@ namespace OpenGL
 		}
 	};
 
-	struct EasyAI :Player
-	{
-		Physics* physics;
-		unsigned int id;
-		EasyAI(Physics* _physics, unsigned int _id)
-			:
-			physics(_physics),
-			id(_id)
-		{
-
-		}
-		virtual Movement update()override
-		{
-			using namespace Math;
-			double theta((Math::Pi * id) / 3);
-			vec2<double> n{ -sin(theta), cos(theta) };
-			Physics::LineSegment dr(physics->r, physics->r + n);
-			double t2 = dr.intersect(physics->lines[id]).t2;
-
-			if (t2 >= -0.1 && t2 <= 1.1)
-			{
-				double target(t2 * 2 - 1);
-				if (target > physics->inputs[id].pos)return Right;
-				else return Left;
-			}
-			else
-			{
-				if (physics->inputs[id].pos > 0)return Left;
-				else return Right;
-			}
-		}
-	};
-	struct BrutalAI :Player
-	{
-		Physics* physics;
-		unsigned int id;
-
-		BrutalAI(Physics* _physics, unsigned int _id)
-			:
-			physics(_physics),
-			id(_id)
-		{
-
-		}
-		virtual Movement update()override
-		{
-			double t1(physics->its[id].t1);
-			double t2(physics->its[id].t2);
-			if (t2 >= -0.5 && t2 <= 1.5 && t1 > 0)
-			{
-				double target(t2 * 2 - 1);
-				if (target > physics->inputs[id].pos)return Right;
-				else return Left;
-			}
-			else
-			{
-				if (physics->inputs[id].pos > 0)return Left;
-				else return Right;
-			}
-		}
-	};
-
 	struct HexPong :OpenGL
 	{
 		struct BorderRenderer :Program
 		{
 			struct LineData :Buffer::Data
 			{
-				struct Vertex
-				{
-					Math::vec2<float> pos;
-					Color color;
-				};
-				Vertex lines[6];
+				using Vertex = Mesh::LineVertex;
+				Vertex lines[maxSides];
+				unsigned int count;
 
 				LineData()
 					:
-					Data(StaticDraw)
+					Data(StaticDraw),
+					count(0)
 				{
-					float h = scale * sqrt(3) / 2;
-					float a = scale;
-					float a2 = scale * 0.5;
-
-					lines[0].pos = { -a2, -h };//user
-					lines[1].pos = { a2, -h };
-					lines[2].pos = { a, 0 };
-					lines[3].pos = { a2 , h };
-					lines[4].pos = { -a2, h };
-					lines[5].pos = { -a, 0 };
-
-					lines[0].color = cyan;
-					lines[1].color = blue;
-					lines[2].color = purple;
-					lines[3].color = orange;
-					lines[4].color = yellow;
-					lines[5].color = green;
+					build(Arena(), Tuning());
+				}
+				void build(Arena const& _arena, Tuning const& _tuning)
+				{
+					count = Mesh::border(_arena, _tuning, lines);
 				}
 				virtual void* pointer()override
 				{
@@ -388,6 +99,8 @@ namespace OpenGL
 
 			VertexAttrib positions;
 			VertexAttrib colors;
+			//views drawn by one call, see FrameRing
+			GLsizei instances;
 
 			BorderRenderer(SourceManager* _sourceManager)
 				:
@@ -398,7 +111,8 @@ namespace OpenGL
 				positions(&bufferArray, 0, VertexAttrib::two,
 					VertexAttrib::Float, false, sizeof(LineData::Vertex), 0, 0),
 				colors(&bufferArray, 1, VertexAttrib::three,
-					VertexAttrib::Float, false, sizeof(LineData::Vertex), sizeof(Math::vec2<float>), 0)
+					VertexAttrib::Float, false, sizeof(LineData::Vertex), sizeof(Math::vec2<float>), 0),
+				instances(1)
 			{
 				init();
 			}
@@ -411,7 +125,7 @@ namespace OpenGL
 			}
 			virtual void run() override
 			{
-				glDrawArrays(GL_LINE_LOOP, 0, 6);
+				glDrawArraysInstanced(GL_LINE_LOOP, 0, borderLines.count, instances);
 			}
 			void resize(int _w, int _h)
 			{
@@ -422,142 +136,71 @@ namespace OpenGL
 		{
 			struct RectangleData :Buffer::Data
 			{
-				struct Rectangle
-				{
-					Math::vec2<float> p[6];
-				};
-				Rectangle rectangles[6];
+				using Rectangle = Mesh::Rectangle;
+				Rectangle rectangles[maxSides];
+				unsigned int count;
 
 				RectangleData()
 					:
-					Data(StaticDraw)
-				{
-					double h = sqrt(3) / 2;
-					rectangles[0].p[0] = { -playerW / 2, float(-h - playerH) };
-					rectangles[0].p[1] = { playerW / 2, float(-h - playerH) };
-					rectangles[0].p[2] = { playerW / 2, float(-h) };
-					rectangles[0].p[3] = { -playerW / 2, float(-h) };
-					for (unsigned int c0(0); c0 < 4; ++c0)
-						rectangles[0].p[c0] *= scale;
-					rectangles[0].p[4] = rectangles[0].p[0];
-					rectangles[0].p[5] = rectangles[0].p[2];
-
-					Math::mat2<double> rotation;
-					for (unsigned int c0(1); c0 < 6; ++c0)
-					{
-						double theta((Math::Pi * c0) / 3);
-						rotation.array[0][0] = cos(theta);
-						rotation.array[0][1] = -sin(theta);
-						rotation.array[1][0] = sin(theta);
-						rotation.array[1][1] = cos(theta);
-						for (unsigned int c1(0); c1 < 4; ++c1)
-							rectangles[c0].p[c1] = (rotation, rectangles[0].p[c1]);
-						rectangles[c0].p[4] = rectangles[c0].p[0];
-						rectangles[c0].p[5] = rectangles[c0].p[2];
-					}
-				}
-				virtual void* pointer()override
+					Data(StaticDraw),
+					count(0)
 				{
-					return (void*)rectangles;
+					build(Arena(), Tuning());
 				}
-				virtual unsigned int size()override
+				void build(Arena const& _arena, Tuning const& _tuning)
 				{
-					return sizeof(rectangles);
-				}
-			};
-			struct OffsetData :Buffer::Data
-			{
-				Math::vec4<float> offsets[6];
-				Math::vec4<unsigned int> inversed;
-
-				OffsetData()
-					:
-					Data(DynamicDraw),
-					offsets{ 0 },
-					inversed{ 0 }
-				{
-				}
-				void update(double* _offsets)
-				{
-					for (unsigned int c0(0); c0 < 6; ++c0)
-					{
-						double theta((Math::Pi * c0) / 3);
-						double a2 = scale * 0.5 * _offsets[c0];
-						offsets[c0].data[0] = a2 * cos(theta);
-						offsets[c0].data[1] = a2 * sin(theta);
-					}
-				}
-				void inverse(bool _inversed)
-				{
-					inversed.data[0] = _inversed;
+					count = Mesh::paddles(_arena, _tuning, rectangles);
 				}
 				virtual void* pointer()override
 				{
-					return (void*)offsets;
+					return (void*)rectangles;
 				}
 				virtual unsigned int size()override
 				{
-					return sizeof(offsets) + sizeof(inversed);
+					return sizeof(rectangles);
 				}
 			};
-
 			RectangleData playerTriangles;
-			OffsetData playerOffset;
 
 			Buffer rectangleBuffer;
-			Buffer offsetBuffer;
 
 			BufferConfig bufferArray;
-			BufferConfig offsetUniform;
 
 			VertexAttrib positions;
+			GLsizei instances;
 
 			PlayerRenderer(SourceManager* _sourceManager)
 				:
 				Program(_sourceManager, "Player", Vector<VertexAttrib*>{&positions}),
 				playerTriangles(),
-				playerOffset(),
 				rectangleBuffer(&playerTriangles),
-				offsetBuffer(&playerOffset),
 				bufferArray(&rectangleBuffer, ArrayBuffer),
-				offsetUniform(&offsetBuffer, UniformBuffer, 0),
 				positions(&bufferArray, 0, VertexAttrib::two,
-					VertexAttrib::Float, false, sizeof(Math::vec2<float>), 0, 0)
+					VertexAttrib::Float, false, sizeof(Math::vec2<float>), 0, 0),
+				instances(1)
 			{
 				init();
 			}
-			void update(double* _offsets)
-			{
-				playerOffset.update(_offsets);
-			}
-			void refreshBuffer(bool _inversed)
-			{
-				playerOffset.inverse(_inversed);
-				offsetUniform.refreshData();
-			}
 			virtual void initBufferData()override
 			{
 			}
 			virtual void run() override
 			{
-				glDrawArrays(GL_TRIANGLES, 0, 6 * 2 * 3);
+				glDrawArraysInstanced(GL_TRIANGLES, 0, playerTriangles.count * 2 * 3, instances);
 			}
 		};
 		struct BallRenderer :Program
 		{
+			//the origin; the shader adds the ball position from FrameRing
 			struct BallData :Buffer::Data
 			{
 				Math::vec2<float> position;
 				BallData()
 					:
-					Data(DynamicDraw),
+					Data(StaticDraw),
 					position{ 0 }
 				{
 				}
-				void update(Math::vec2<float>pos)
-				{
-					position = pos * scale;
-				}
 				virtual void* pointer()override
 				{
 					return (void*)position.data;
@@ -572,6 +215,9 @@ namespace OpenGL
 			Buffer ballBuffer;
 			BufferConfig bufferArray;
 			VertexAttrib positions;
+			GLsizei instances;
+			//side of a view in pixels
+			float pixels;
 
 			BallRenderer(SourceManager* _SourceManager)
 				:
@@ -580,22 +226,19 @@ namespace OpenGL
 				ballBuffer(&ballPos),
 				bufferArray(&ballBuffer, ArrayBuffer),
 				positions(&bufferArray, 0, VertexAttrib::two,
-					VertexAttrib::Float, false, sizeof(Math::vec2<float>), 0, 0)
+					VertexAttrib::Float, false, sizeof(Math::vec2<float>), 0, 0),
+				instances(1),
+				pixels(windowSize)
 			{
 				init();
 			}
-			void refreshBuffer(Math::vec2<float>pos)
-			{
-				ballPos.update(pos);
-				bufferArray.refreshData();
-			}
 			virtual void initBufferData()override
 			{
 			}
 			virtual void run() override
 			{
-				glPointSize(10);
-				glDrawArrays(GL_POINTS, 0, 1);
+				glPointSize(10 * pixels / windowSize);
+				glDrawArraysInstanced(GL_POINTS, 0, 1, instances);
 			}
 		};
 		struct CircleRenderer :Program
@@ -623,6 +266,10 @@ namespace OpenGL
 			Buffer ballBuffer;
 			BufferConfig bufferArray;
 			VertexAttrib positions;
+			GLsizei instances;
+			float pixels;
+			//r0 in units of a view's side
+			float radius;
 
 			CircleRenderer(SourceManager* _SourceManager)
 				:
@@ -631,7 +278,77 @@ namespace OpenGL
 				ballBuffer(&circleData),
 				bufferArray(&ballBuffer, ArrayBuffer),
 				positions(&bufferArray, 0, VertexAttrib::two,
-					VertexAttrib::Float, false, sizeof(Math::vec2<float>), 0, 0)
+					VertexAttrib::Float, false, sizeof(Math::vec2<float>), 0, 0),
+				instances(1),
+				pixels(windowSize),
+				radius(float(scale * r0))
+			{
+				init();
+			}
+			virtual void initBufferData()override
+			{
+			}
+			virtual void run() override
+			{
+				glPointSize(pixels * radius);
+				glDrawArraysInstanced(GL_POINTS, 0, 1, instances);
+			}
+		};
+
+		// The whole scene from one program and one interleaved vertex stream
+		// (Mesh::scene). Two instanced draws per frame cover every view.
+		struct SceneRenderer :Program
+		{
+			struct SceneData :Buffer::Data
+			{
+				using Vertex = Mesh::SceneVertex;
+				Vertex vertices[Mesh::sceneCapacity];
+				unsigned int lines;
+				unsigned int triangles;
+
+				SceneData()
+					:
+					Data(StaticDraw),
+					lines(0),
+					triangles(0)
+				{
+					build(Arena(), Tuning());
+				}
+				void build(Arena const& _arena, Tuning const& _tuning)
+				{
+					Mesh::scene(_arena, _tuning, vertices, lines, triangles);
+				}
+				virtual void* pointer()override
+				{
+					return (void*)vertices;
+				}
+				virtual unsigned int size()override
+				{
+					return sizeof(vertices);
+				}
+			};
+
+			SceneData sceneData;
+			Buffer buffer;
+			BufferConfig bufferArray;
+			VertexAttrib positions;
+			VertexAttrib locals;
+			VertexAttrib tags;
+			GLsizei instances;
+
+			SceneRenderer(SourceManager* _sourceManager)
+				:
+				Program(_sourceManager, "Scene", Vector<VertexAttrib*>{&positions, & locals, & tags}),
+				sceneData(),
+				buffer(&sceneData),
+				bufferArray(&buffer, ArrayBuffer),
+				positions(&bufferArray, 0, VertexAttrib::two,
+					VertexAttrib::Float, false, sizeof(SceneData::Vertex), 0, 0),
+				locals(&bufferArray, 1, VertexAttrib::two,
+					VertexAttrib::Float, false, sizeof(SceneData::Vertex), sizeof(Math::vec2<float>), 0),
+				tags(&bufferArray, 2, VertexAttrib::two,
+					VertexAttrib::Float, false, sizeof(SceneData::Vertex), 2 * sizeof(Math::vec2<float>), 0),
+				instances(1)
 			{
 				init();
 			}
@@ -640,8 +357,142 @@ namespace OpenGL
 			}
 			virtual void run() override
 			{
-				glPointSize(windowSize * scale * r0);
-				glDrawArrays(GL_POINTS, 0, 1);
+				glDrawArraysInstanced(GL_LINES, 0, sceneData.lines, instances);
+				glDrawArraysInstanced(GL_TRIANGLES, sceneData.lines, sceneData.triangles, instances);
+			}
+		};
+		// CPU time of submitting a frame and GPU time of executing it
+		// (GL_TIME_ELAPSED), summed per render mode. Query results are read
+		// back frames later so that reading them never waits on the GPU.
+		struct FrameTimer
+		{
+			static constexpr unsigned int latency = 4;
+
+			GLuint queries[latency];
+			unsigned int modes[latency];
+			unsigned long long frame;
+			double cpu[2];
+			double gpu[2];
+			unsigned long long frames[2];
+			unsigned long long gpuFrames[2];
+
+			FrameTimer()
+				:
+				queries{ 0 },
+				modes{ 0 },
+				frame(0),
+				cpu{ 0 },
+				gpu{ 0 },
+				frames{ 0 },
+				gpuFrames{ 0 }
+			{
+			}
+			void init()
+			{
+				glGenQueries(latency, queries);
+			}
+			void begin(unsigned int _mode)
+			{
+				unsigned int slot(frame % latency);
+				if (frame >= latency)
+				{
+					GLint available(0);
+					glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+					if (available)
+					{
+						GLuint64 ns(0);
+						glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &ns);
+						gpu[modes[slot]] += ns * 1e-9;
+						++gpuFrames[modes[slot]];
+					}
+				}
+				modes[slot] = _mode;
+				glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+			}
+			void end(unsigned int _mode, double _cpu)
+			{
+				glEndQuery(GL_TIME_ELAPSED);
+				cpu[_mode] += _cpu;
+				++frames[_mode];
+				++frame;
+			}
+			void print(unsigned int _mode, char const* _name)const
+			{
+				if (!frames[_mode])return;
+				printf("%-28s CPU %7.1lf us/frame, GPU %7.1lf us/frame (%llu frames)\n", _name,
+					cpu[_mode] / frames[_mode] * 1e6,
+					gpuFrames[_mode] ? gpu[_mode] / gpuFrames[_mode] * 1e6 : 0.0, frames[_mode]);
+			}
+		};
+
+		// GL_TIMESTAMP pairs around each draw section, read back latency
+		// frames later onto a "GPU" probe track shifted to the CPU clock.
+		// Unlike GL_TIME_ELAPSED these nest inside FrameTimer's query.
+		// Everything is skipped in builds without HEXPONG_PROBES.
+		struct GpuProbes
+		{
+			static constexpr unsigned int latency = 4;
+			static constexpr unsigned int sections = 32;
+
+			GLuint queries[latency][2 * sections];
+			char const* names[latency][sections];
+			unsigned int counts[latency];
+			unsigned long long frame;
+			long long offset;
+			Probe::Ring* ring;
+
+			GpuProbes()
+				:
+				queries{ 0 },
+				names{ 0 },
+				counts{ 0 },
+				frame(0),
+				offset(0),
+				ring(nullptr)
+			{
+			}
+			void init()
+			{
+				if (!Probe::enabled)return;
+				glGenQueries(latency * 2 * sections, queries[0]);
+				GLint64 gpu(0);
+				glGetInteger64v(GL_TIMESTAMP, &gpu);
+				offset = Probe::now() - gpu;
+				ring = Probe::Registry::get().add("GPU");
+			}
+			void beginFrame()
+			{
+				if (!ring)return;
+				unsigned int slot(frame % latency);
+				for (unsigned int c0(0); c0 < counts[slot]; ++c0)
+				{
+					GLint available(0);
+					glGetQueryObjectiv(queries[slot][2 * c0 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+					if (!available)break;
+					GLuint64 begin(0), end(0);
+					glGetQueryObjectui64v(queries[slot][2 * c0], GL_QUERY_RESULT, &begin);
+					glGetQueryObjectui64v(queries[slot][2 * c0 + 1], GL_QUERY_RESULT, &end);
+					ring->push(names[slot][c0], (long long)begin + offset, (long long)end + offset);
+				}
+				counts[slot] = 0;
+			}
+			void begin(char const* _name)
+			{
+				unsigned int slot(frame % latency);
+				if (!ring || counts[slot] == sections)return;
+				names[slot][counts[slot]] = _name;
+				glQueryCounter(queries[slot][2 * counts[slot]], GL_TIMESTAMP);
+			}
+			void end()
+			{
+				unsigned int slot(frame % latency);
+				if (!ring || counts[slot] == sections)return;
+				glQueryCounter(queries[slot][2 * counts[slot] + 1], GL_TIMESTAMP);
+				++counts[slot];
+			}
+			void endFrame()
+			{
+				++frame;
 			}
 		};
 
@@ -650,47 +501,216 @@ namespace OpenGL
 		PlayerRenderer playerRenderer;
 		BallRenderer ballRenderer;
 		CircleRenderer circleRenderer;
+		SceneRenderer sceneRenderer;
+		FrameRing frameRing;
+		ViewLayout layout;
+		bool instanced;
+		//one program and two draws, or the four per-object programs
+		bool batched;
+		FrameTimer timer;
+		GpuProbes gpuProbes;
 
 		RealPlayer0 realPlayer0;
 		RealPlayer1 realPlayer1;
 		//EasyAI simpleAIs[2];
 		BrutalAI brutalAIs[4];
-		Player* players[6];
+		//other arenas: the keyboard players at seat 0 and the one opposite,
+		//BrutalAIs elsewhere, called through Player*
+		std::unique_ptr<Player> seatAIs[maxSides];
+		Player* seats[maxSides];
 
 		Physics physics;
+		FixedStep clock;
+		Math::vec2<double> lastR;
+		double lastOffsets[maxSides];
 		unsigned int frames;
-		unsigned int losts[6];
-
-		HexPong()
+		unsigned int losts[maxSides];
+		//recorded games play back headless too: Headless -P <file>
+		Replay::Writer recorder;
+		Replay::Reader replay;
+		Player* replaySeats[maxSides];
+		bool replaying;
+		//peer-to-peer rollback netplay; this peer's seats after the two
+		//keyboard players are BrutalAIs
+		Netplay::Session session;
+		std::unique_ptr<Player> netAIs[maxSides];
+		bool networked;
+		//HexPong.cfg in the working directory (see Config.h), polled twice a
+		//second; its frameRate sets dt, the tick rate stays the command line's
+		Config::Watcher config;
+		std::chrono::steady_clock::time_point polled;
+		//with "telemetry <file>", every bounce and loss to that file (Headless
+		//-Q reads it); not while networked, where rollbacks would log frames twice
+		Telemetry::Log telemetry;
+		Telemetry::Ring* telemetryRing;
+		char const* telemetryPath;
+		unsigned long long ticks;
+		unsigned long long served;
+
+		HexPong(double _tickRate = frameRate, unsigned int _maxSteps = 5, unsigned int _sides = Hexagon::sides,
+			char const* _record = nullptr, char const* _replay = nullptr, char const* _telemetry = nullptr)
 			:
 			sm(),
 			renderer(&sm),
 			playerRenderer(&sm),
 			ballRenderer(&sm),
 			circleRenderer(&sm),
+			sceneRenderer(&sm),
+			frameRing(),
+			layout(),
+			instanced(true),
+			batched(true),
+			timer(),
+			gpuProbes(),
 			realPlayer0(),
 			realPlayer1(),
 			brutalAIs{ {&physics,1},{&physics,2},{&physics,4},{&physics,5} },
 			//simpleAIs{ {&physics,2}, {&physics,4} },
-			players{ 0 },
-			physics(),
+			seatAIs(),
+			seats{ 0 },
+			physics(_sides),
+			clock(_tickRate, _maxSteps),
+			lastR(physics.r),
+			lastOffsets{ 0 },
 			frames(60),
-			losts{ 0 }
+			losts{ 0 },
+			recorder(),
+			replay(),
+			replaySeats{ 0 },
+			replaying(false),
+			session(&physics),
+			networked(false),
+			config("HexPong.cfg"),
+			polled(std::chrono::steady_clock::now()),
+			telemetry(),
+			telemetryRing(nullptr),
+			telemetryPath(_telemetry),
+			ticks(0),
+			served(0)
 		{
-			players[0] = &realPlayer0;
-			players[3] = &realPlayer1;
-			players[1] = brutalAIs;
-			players[2] = brutalAIs + 1;
-			players[4] = brutalAIs + 2;
-			players[5] = brutalAIs + 3;
+			for (unsigned int c0(0); c0 < maxSides; ++c0)
+				replaySeats[c0] = replay.seats + c0;
+			retune(physics.tuning, false);
+			reload(false);
+			if (_replay)
+			{
+				//the recording's arena replaces _sides
+				replaying = replay.open(_replay);
+				if (replaying)
+				{
+					replay.start(physics);
+					retune(physics.tuning, false);
+					lastR = physics.r;
+				}
+				else printf("Cannot read replay %s\n", _replay);
+			}
+			unsigned int sides(physics.arena.sides);
+			layout = ViewLayout::split(sides);
+			char roster[maxSides + 1]{ 0 };
+			for (unsigned int c0(0); c0 < sides; ++c0)
+			{
+				roster[c0] = c0 == 0 || c0 == sides / 2 ? 'H' : 'B';
+				if (c0 == 0)seats[c0] = &realPlayer0;
+				else if (c0 == sides / 2)seats[c0] = &realPlayer1;
+				else if (sides != Hexagon::sides)
+				{
+					seatAIs[c0].reset(createPlayer(BrutalSeat, &physics, c0));
+					seats[c0] = seatAIs[c0].get();
+				}
+			}
+			if (!_replay && _record && !recorder.open(_record, physics, roster))
+				printf("Cannot write replay %s\n", _record);
+			if (_telemetry)
+			{
+				if (telemetry.open(_telemetry))telemetryRing = telemetry.add();
+				else printf("Cannot write telemetry %s\n", _telemetry);
+			}
+		}
+		~HexPong()
+		{
+			if (!recorder.close(physics))printf("The replay could not be written completely\n");
+		}
+		//physics and the geometry built from the tuning; _upload once GL is up
+		void retune(Tuning const& _tuning, bool _upload)
+		{
+			physics.tune(_tuning);
+			Arena const& arena(physics.arena);
+			renderer.borderLines.build(arena, _tuning);
+			playerRenderer.playerTriangles.build(arena, _tuning);
+			sceneRenderer.sceneData.build(arena, _tuning);
+			circleRenderer.radius = float(_tuning.scale / arena.R * _tuning.r0);
+			frameRing.scale = _tuning.scale / arena.R;
+			if (!_upload)return;
+			renderer.bufferArray.dataInit();
+			playerRenderer.bufferArray.dataInit();
+			sceneRenderer.bufferArray.dataInit();
+		}
+		// Applies HexPong.cfg if it changed. A recorded, replayed or networked
+		// match keeps the tuning it started with, since a replay stores one
+		// tuning and every peer has to step the same physics.
+		void reload(bool _upload)
+		{
+			Tuning a(physics.tuning);
+			std::string error;
+			if (!config.poll(a, error))
+			{
+				if (error.size())printf("\n%s: %s\n", config.path.c_str(), error.c_str());
+				return;
+			}
+			if (replaying || networked || recorder.file)
+			{
+				printf("\n%s changed; the tuning is fixed while recording, replaying or networked\n", config.path.c_str());
+				return;
+			}
+			retune(a, _upload);
+			printf("\nLoaded %s: G %g, r0 %g, playerW %g, playerSpeed %g, ballSpeed %g, dt %g\n", config.path.c_str(),
+				a.G, a.r0, a.playerW, a.playerSpeed, a.ballSpeed, a.dt);
+		}
+		//seat c belongs to peer c % _peers; serves are not paused while networked
+		bool connect(unsigned int _me, unsigned int _peers, Netplay::Address const* _addresses)
+		{
+			unsigned int owners[maxSides];
+			Player* local[maxSides];
+			unsigned int humans(0);
+			for (unsigned int c0(0); c0 < physics.arena.sides; ++c0)
+			{
+				owners[c0] = c0 % _peers;
+				local[c0] = nullptr;
+				if (owners[c0] != _me)continue;
+				if (humans == 0)local[c0] = &realPlayer0;
+				else if (humans == 1)local[c0] = &realPlayer1;
+				else
+				{
+					netAIs[c0].reset(createPlayer(BrutalSeat, &physics, c0));
+					local[c0] = netAIs[c0].get();
+				}
+				++humans;
+			}
+			networked = session.open(_me, _peers, owners, _addresses, local);
+			if (networked)frames = 0;
+			return networked;
+		}
+		//hexagon seat layout, dispatched at compile time by Physics::update
+		auto players()
+		{
+			return std::tie(realPlayer0, brutalAIs[0], brutalAIs[1], realPlayer1, brutalAIs[2], brutalAIs[3]);
 		}
 
 		void printScores()
 		{
-			for (unsigned int c0(0); c0 < 6; ++c0)
+			for (unsigned int c0(0); c0 < physics.arena.sides; ++c0)
 			{
 				printf("Player %u Losts: %u\n", c0, losts[c0]);
 			}
+			timer.print(1, "Batched scene program:");
+			timer.print(0, "Four programs per view:");
+			printf("Frames that waited for the GPU: %llu\n", frameRing.waits);
+			printf("Last view mode: %u views, %s\n", layout.views, instanced ? "one instanced pass" : "one pass per view");
+			//called at exit, so the file is finished here
+			telemetry.close();
+			if (telemetryRing)
+				printf("Telemetry: %llu events, %llu bytes in %s, %llu dropped\n",
+					telemetry.events, telemetry.bytes, telemetryPath, telemetry.dropped);
 		}
 
 		virtual void init(FrameScale const& _size) override
@@ -699,60 +719,133 @@ namespace OpenGL
 			renderer.bufferArray.dataInit();
 
 			playerRenderer.bufferArray.dataInit();
-			playerRenderer.offsetUniform.dataInit();
 
 			ballRenderer.bufferArray.dataInit();
 
 			circleRenderer.bufferArray.dataInit();
 
+			sceneRenderer.bufferArray.dataInit();
+
+			frameRing.init();
+			timer.init();
+			gpuProbes.init();
 		}
-		virtual void run() override
+		//one fixed physics step; frames counts ticks of the pause after a point
+		void tick()
 		{
+			lastR = physics.r;
+			for (unsigned int c0(0); c0 < physics.arena.sides; ++c0)
+				lastOffsets[c0] = physics.offsets[c0];
+			if (networked)
+			{
+				session.advance();
+				for (unsigned int c0(0); c0 < physics.arena.sides; ++c0)
+					for (; losts[c0] < session.losts[c0]; ++losts[c0])
+						printf("Player %u lost!\n", c0);
+				return;
+			}
 			if (frames)frames--;
 			if (frames == 0)
-				physics.update(players);
+			{
+				//a finished replay freezes on its last frame
+				if (!replaying || replay.next(physics))
+				{
+					if (replaying)physics.update(replaySeats);
+					else
+					{
+						if (physics.arena.sides == Hexagon::sides)physics.update(players());
+						else physics.update(seats);
+						if (recorder.file)recorder.frame(physics);
+					}
+					++ticks;
+					if (telemetryRing)telemetryRing->record(physics, ticks, ticks - served);
+				}
+			}
 			if (physics.ended)
 			{
+				served = ticks;
+				printf("Player %u lost!\n", physics.lostPlayer);
 				losts[physics.lostPlayer]++;
 				frames = 180;
 				physics.ended = false;
 				physics.init();
+				lastR = physics.r;
+				for (unsigned int c0(0); c0 < physics.arena.sides; ++c0)
+					lastOffsets[c0] = physics.offsets[c0];
+			}
+		}
+		virtual void run() override
+		{
+			auto now(std::chrono::steady_clock::now());
+			if (now - polled >= std::chrono::milliseconds(500))
+			{
+				polled = now;
+				reload(true);
+			}
+			for (unsigned int c0(clock.advance()); c0; --c0)
+			{
+				PONG_PROBE("HexPong::tick");
+				tick();
+			}
+			auto t0(std::chrono::steady_clock::now());
+			gpuProbes.beginFrame();
+			timer.begin(batched);
+			double alpha(clock.alpha());
+			Math::vec2<double> ball(lastR + (physics.r - lastR) * alpha);
+			double offsets[maxSides];
+			for (unsigned int c0(0); c0 < physics.arena.sides; ++c0)
+				offsets[c0] = lastOffsets[c0] + (physics.offsets[c0] - lastOffsets[c0]) * alpha;
+			double width(2 * windowSize), height(windowSize);
+			{
+				PONG_PROBE("FrameRing::write");
+				frameRing.write(physics.arena, offsets, ball, layout, instanced, width, height);
 			}
 
 			glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 			glClear(GL_COLOR_BUFFER_BIT);
 
-			glViewport(0, 0, windowSize, windowSize);
-			playerRenderer.update(physics.offsets);
-			playerRenderer.refreshBuffer(false);
-
-			renderer.use();
-			renderer.refreshBuffer();
-			renderer.run();
-
-			playerRenderer.use();
-			playerRenderer.run();
-
-			circleRenderer.use();
-			circleRenderer.run();
-
-			ballRenderer.use();
-			ballRenderer.refreshBuffer(physics.r);
-			ballRenderer.run();
-
-			glViewport(windowSize, 0, windowSize, windowSize);
-			playerRenderer.refreshBuffer(true);
-			renderer.use();
-			renderer.run();
-
-			playerRenderer.use();
-			playerRenderer.run();
-
-			circleRenderer.use();
-			circleRenderer.run();
+			double x, y, side;
+			layout.tile(0, width, height, x, y, side);
+			GLsizei instances(instanced ? layout.views : 1);
+			renderer.instances = instances;
+			playerRenderer.instances = instances;
+			circleRenderer.instances = instances;
+			ballRenderer.instances = instances;
+			sceneRenderer.instances = instances;
+			circleRenderer.pixels = float(side);
+			ballRenderer.pixels = float(side);
+			for (unsigned int c0(0); c0 < (instanced ? 1 : layout.views); ++c0)
+			{
+				if (instanced)glViewport(0, 0, width, height);
+				else
+				{
+					layout.tile(c0, width, height, x, y, side);
+					glViewport(x, y, side, side);
+				}
+				frameRing.bind(c0);
 
-			ballRenderer.use();
-			ballRenderer.run();
+				if (batched)
+				{
+					draw("SceneRenderer::run", sceneRenderer);
+					continue;
+				}
+				draw("BorderRenderer::run", renderer);
+				draw("PlayerRenderer::run", playerRenderer);
+				draw("CircleRenderer::run", circleRenderer);
+				draw("BallRenderer::run", ballRenderer);
+			}
+			frameRing.fence();
+			gpuProbes.endFrame();
+			timer.end(batched, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+		}
+		//use() and run() under a CPU and a GPU probe of the same name
+		void draw(char const* _name, Program& _program)
+		{
+			PONG_PROBE(_name);
+			gpuProbes.begin(_name);
+			_program.use();
+			_program.run();
+			gpuProbes.end();
 		}
 		virtual void frameSize(int _w, int _h) override
 		{
@@ -783,6 +876,18 @@ namespace OpenGL
 			case GLFW_KEY_D:realPlayer0.D_key = _action; break;
 			case GLFW_KEY_LEFT:realPlayer1.L_key = _action; break;
 			case GLFW_KEY_RIGHT:realPlayer1.R_key = _action; break;
+			//V: two views or one per seat, I: instanced or one pass per view
+			case GLFW_KEY_V:
+				if (_action == GLFW_PRESS)
+					layout = layout.views == 2 ? ViewLayout::all(physics.arena.sides) : ViewLayout::split(physics.arena.sides);
+				break;
+			case GLFW_KEY_I:
+				if (_action == GLFW_PRESS)instanced = !instanced;
+				break;
+			//B: batched scene program or the four per-object programs
+			case GLFW_KEY_B:
+				if (_action == GLFW_PRESS)batched = !batched;
+				break;
 				//case GLFW_KEY_W: break;
 				//case GLFW_KEY_S: break;
 			}
@@ -790,7 +895,7 @@ namespace OpenGL
 	};
 }
 
-int main()
+int main(int argc, char** argv)
 {
 	OpenGL::OpenGLInit init(4, 5);
 	Window::Window::Data winParameters
@@ -802,21 +907,71 @@ int main()
 		}
 	};
 	Window::WindowManager wm(winParameters);
-	OpenGL::HexPong test;
+	//HexPong [ticks per second] [sides <3..32>] [telemetry <file>] [record <file> | replay <file> | net <me> <a.b.c.d:port>...]
+	//the tick rate is independent of the display rate
+	char const* record(nullptr);
+	char const* replay(nullptr);
+	char const* telemetry(nullptr);
+	unsigned int sides(Pong::Hexagon::sides);
+	int arg(2);
+	if (argc > arg + 1 && !strcmp(argv[arg], "sides"))
+	{
+		sides = strtoul(argv[arg + 1], nullptr, 10);
+		if (!Pong::validSides(sides))
+		{
+			printf("sides %s: the arena has 3 to %u sides\n", argv[arg + 1], Pong::maxSides);
+			return 1;
+		}
+		arg += 2;
+	}
+	if (argc > arg + 1 && !strcmp(argv[arg], "telemetry"))
+	{
+		telemetry = argv[arg + 1];
+		arg += 2;
+	}
+	if (argc > arg + 1 && !strcmp(argv[arg], "record"))record = argv[arg + 1];
+	if (argc > arg + 1 && !strcmp(argv[arg], "replay"))replay = argv[arg + 1];
+	OpenGL::HexPong test(argc > 1 ? atof(argv[1]) : OpenGL::frameRate, 5, sides, record, replay, telemetry);
+	if (argc > arg + 2 && !strcmp(argv[arg], "net"))
+	{
+		Pong::Netplay::Address addresses[Pong::maxSides];
+		unsigned int peers(argc - arg - 2);
+		bool valid(peers <= test.physics.arena.sides);
+		for (unsigned int c0(0); valid && c0 < peers; ++c0)
+			valid = Pong::Netplay::Address::parse(argv[arg + 2 + c0], addresses[c0]);
+		if (!valid || !test.connect(atoi(argv[arg + 1]), peers, addresses))
+		{
+			printf("Cannot join as peer %s of %u\n", argv[arg + 1], peers);
+			return 1;
+		}
+	}
 	wm.init(0, &test);
 	glfwSwapInterval(1);
 	FPS fps;
 	fps.refresh();
+	//the rate is printed twice a second rather than every frame (a write per frame)
+	auto shown(std::chrono::steady_clock::now());
 	while (!wm.close())
 	{
 		wm.pullEvents();
 		wm.render();
 		wm.swapBuffers();
 		fps.refresh();
-		::printf("\r%.2lf    ", fps.fps);
+		auto now(std::chrono::steady_clock::now());
+		if (now - shown >= std::chrono::milliseconds(500))
+		{
+			::printf("\r%.2lf    ", fps.fps);
+			fflush(stdout);
+			shown = now;
+		}
 		//fps.printFPS(1);
 	}
 	printf("\m");
 	test.printScores();
+	if (Pong::Probe::enabled)
+	{
+		Pong::Probe::print(stdout);
+		if (!Pong::Probe::writeTrace("HexPong.trace.json"))printf("Cannot write HexPong.trace.json\n");
+	}
 	return 0;
 }
@@ -0,0 +1,293 @@
+#pragma once
+#include <cmath>
+#include <cstring>
+#include <HexPongCore/Physics.h>
+
+// What the game puts in its GL buffers, shared with GLCheck: the colours,
+// the view layouts, the per-frame ring and the static vertex data of every
+// renderer. Nothing here loads GL; include GL/_Window.h (the game) or
+// GL/glcorearb.h (GLCheck) first.
+namespace OpenGL
+{
+	using namespace Pong;
+
+	struct Color
+	{
+		float r, g, b;
+	};
+	constexpr Color red = { 1.f, 0.f, 0.f };
+	constexpr Color orange = { 1.f, 127.f / 255.f, 0.f };
+	constexpr Color yellow = { 1.f, 1.f, 0.f };
+	constexpr Color green = { 0.f, 1.f, 0.f };
+	constexpr Color cyan = { 0.f, 1.f, 1.f };
+	constexpr Color blue = { 0.f, 0.f, 1.f };
+	constexpr Color purple = { 127.f / 255.f, 0.f, 1.f };
+
+	constexpr double windowSize = 800;
+	constexpr double scale = 0.9;
+
+	// Which seat each view puts at the bottom and where the views sit in the
+	// window: a cols x rows grid of square tiles, each as large as fits.
+	struct ViewLayout
+	{
+		unsigned int views;
+		unsigned int cols;
+		unsigned int rows;
+		unsigned int seats[maxSides];
+
+		//the two keyboard players face each other
+		static ViewLayout split(unsigned int _sides)
+		{
+			return { 2, 2, 1, { 0, _sides / 2 } };
+		}
+		//one view per seat, about 3:2 like Raster::Renderer (3 x 2 for six)
+		static ViewLayout all(unsigned int _sides)
+		{
+			ViewLayout a{ _sides, (unsigned int)ceil(sqrt(1.5 * _sides)), 1, { 0 } };
+			a.rows = (_sides + a.cols - 1) / a.cols;
+			for (unsigned int c0(0); c0 < _sides; ++c0)
+				a.seats[c0] = c0;
+			return a;
+		}
+		//lower left corner and side in pixels of view _v in a _w x _h window
+		void tile(unsigned int _v, double _w, double _h, double& _x, double& _y, double& _side)const
+		{
+			double cw(_w / cols), ch(_h / rows);
+			_side = cw < ch ? cw : ch;
+			_x = (_v % cols + 0.5) * cw - _side / 2;
+			_y = (rows - _v / cols - 0.5) * ch - _side / 2;
+		}
+	};
+
+	// Per-frame shader data (paddle offsets, ball, each view's rotation and
+	// tile), written once per frame into a persistently mapped, coherent
+	// uniform buffer. Three slots rotate so that the CPU fills one while the
+	// GPU may still read the others; a fence per slot guards reuse, and waits
+	// counts the frames where that fence was not signalled yet.
+	// Drawn one pass per view, a slot holds one block per view at offsets the
+	// UBO alignment allows, each with that view alone in a full tile, and a
+	// pass selects its block with glBindBufferRange. Drawn instanced, one
+	// block holds every view and gl_InstanceID picks the view.
+	struct FrameRing
+	{
+		//std140 layout of FrameBuffer in the vertex shaders
+		struct Block
+		{
+			float offsets[maxSides][4];
+			float ball[2];
+			float padding[2];
+			float rotations[maxSides][4];
+			float tiles[maxSides][4];
+		};
+		static constexpr unsigned int slots = 3;
+		static constexpr unsigned int passes = maxSides;
+
+		GLuint buffer;
+		unsigned int stride;
+		unsigned int slotSize;
+		unsigned char* mapped;
+		GLsync fences[slots];
+		unsigned int slot;
+		unsigned long long waits;
+		double scale;
+
+		FrameRing()
+			:
+			buffer(0),
+			stride(0),
+			slotSize(0),
+			mapped(nullptr),
+			fences{ 0 },
+			slot(0),
+			waits(0),
+			scale(Defaults::scale)
+		{
+		}
+		~FrameRing()
+		{
+			for (unsigned int c0(0); c0 < slots; ++c0)
+				if (fences[c0])glDeleteSync(fences[c0]);
+			if (buffer)
+			{
+				glUnmapNamedBuffer(buffer);
+				glDeleteBuffers(1, &buffer);
+			}
+		}
+		void init()
+		{
+			GLint alignment(256);
+			glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+			stride = (sizeof(Block) + alignment - 1) / alignment * alignment;
+			slotSize = stride * passes;
+			GLbitfield flags(GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT);
+			glCreateBuffers(1, &buffer);
+			glNamedBufferStorage(buffer, slotSize * slots, nullptr, flags);
+			mapped = (unsigned char*)glMapNamedBufferRange(buffer, 0, slotSize * slots, flags);
+		}
+		//scale is that of the arena, so that its vertices stay in the tile
+		void write(Arena const& _arena, double const* _offsets, Math::vec2<double> _ball,
+			ViewLayout const& _layout, bool _instanced, double _w, double _h)
+		{
+			slot = (slot + 1) % slots;
+			if (fences[slot])
+			{
+				GLenum a(glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000));
+				if (a != GL_ALREADY_SIGNALED)++waits;
+				glDeleteSync(fences[slot]);
+				fences[slot] = 0;
+			}
+			Block a;
+			memset(&a, 0, sizeof(a));
+			for (unsigned int c0(0); c0 < _arena.sides; ++c0)
+			{
+				double a2 = scale * 0.5 * _offsets[c0];
+				a.offsets[c0][0] = float(a2 * _arena.cosines[c0]);
+				a.offsets[c0][1] = float(a2 * _arena.sines[c0]);
+			}
+			a.ball[0] = float(_ball[0] * scale);
+			a.ball[1] = float(_ball[1] * scale);
+			for (unsigned int c0(0); c0 < _layout.views; ++c0)
+			{
+				//rotate by minus the seat's angle so that its edge is at the bottom
+				unsigned int seat(_layout.seats[c0]);
+				unsigned int view(_instanced ? c0 : 0);
+				a.rotations[view][0] = float(_arena.cosines[seat]);
+				a.rotations[view][1] = float(-_arena.sines[seat]);
+				double x, y, side;
+				_layout.tile(c0, _w, _h, x, y, side);
+				a.tiles[view][0] = _instanced ? float((x + side / 2) / _w * 2 - 1) : 0.f;
+				a.tiles[view][1] = _instanced ? float((y + side / 2) / _h * 2 - 1) : 0.f;
+				a.tiles[view][2] = _instanced ? float(side / _w) : 1.f;
+				a.tiles[view][3] = _instanced ? float(side / _h) : 1.f;
+				if (!_instanced)memcpy(mapped + slot * slotSize + c0 * stride, &a, sizeof(a));
+			}
+			if (_instanced)memcpy(mapped + slot * slotSize, &a, sizeof(a));
+		}
+		void bind(unsigned int _pass)
+		{
+			glBindBufferRange(GL_UNIFORM_BUFFER, 0, buffer, slot * slotSize + _pass * stride, sizeof(Block));
+		}
+		//after the last draw that reads this frame's slot
+		void fence()
+		{
+			fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+	};
+
+
+	// Static vertex data of the renderers, rebuilt when the arena or the
+	// tuning changes. Everything is scaled by scale / R, so that the vertices
+	// of any arena lie on a circle of radius scale.
+	namespace Mesh
+	{
+		//BorderRenderer: one line loop, drawn flat from the provoking vertex
+		struct LineVertex
+		{
+			Math::vec2<float> pos;
+			Color color;
+		};
+		//returns the number of vertices
+		inline unsigned int border(Arena const& _arena, Tuning const& _tuning, LineVertex* _lines)
+		{
+			Color const colors[6] = { cyan, blue, purple, orange, yellow, green };
+			//lines[0] is the user
+			for (unsigned int c0(0); c0 < _arena.sides; ++c0)
+			{
+				_lines[c0].pos = _arena.vertex(c0) * (_tuning.scale / _arena.R);
+				_lines[c0].color = colors[c0 % 6];
+			}
+			return _arena.sides;
+		}
+		//PlayerRenderer: two triangles per seat at offset 0; the shader moves
+		//vertex v by the offset of seat v / 6
+		struct Rectangle
+		{
+			Math::vec2<float> p[6];
+		};
+		//returns the number of rectangles
+		inline unsigned int paddles(Arena const& _arena, Tuning const& _tuning, Rectangle* _rectangles)
+		{
+			double h = _arena.h, scale(_tuning.scale / _arena.R);
+			float w(float(_tuning.playerW / 2)), hp(float(-h - _tuning.playerH));
+			_rectangles[0].p[0] = { -w, hp };
+			_rectangles[0].p[1] = { w, hp };
+			_rectangles[0].p[2] = { w, float(-h) };
+			_rectangles[0].p[3] = { -w, float(-h) };
+			for (unsigned int c0(0); c0 < 4; ++c0)
+				_rectangles[0].p[c0] *= scale;
+			_rectangles[0].p[4] = _rectangles[0].p[0];
+			_rectangles[0].p[5] = _rectangles[0].p[2];
+
+			for (unsigned int c0(1); c0 < _arena.sides; ++c0)
+			{
+				for (unsigned int c1(0); c1 < 4; ++c1)
+					_rectangles[c0].p[c1] = _arena.rotate(c0, _rectangles[0].p[c1]);
+				_rectangles[c0].p[4] = _rectangles[c0].p[0];
+				_rectangles[c0].p[5] = _rectangles[c0].p[2];
+			}
+			return _arena.sides;
+		}
+
+		// SceneRenderer: the border as one GL_LINES pair per edge, then
+		// paddles, central circle and ball as triangles (the round ones as
+		// quads shaded by their local coordinates), told apart by a material
+		// id. The tag holds material and index (edge colour or seat) as
+		// floats, which the shaders round.
+		enum Material
+		{
+			BorderMaterial = 0,
+			PaddleMaterial = 1,
+			CircleMaterial = 2,
+			BallMaterial = 3,
+		};
+		struct SceneVertex
+		{
+			Math::vec2<float> pos;
+			Math::vec2<float> local;
+			Math::vec2<float> tag;
+		};
+		//room for the largest arena
+		constexpr unsigned int sceneCapacity = maxSides * 2 + maxSides * 6 + 6 + 6;
+
+		inline void quad(SceneVertex*& _p, double _radius, Material _material)
+		{
+			float const corners[6][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, 1}, {-1, -1}, {1, 1} };
+			for (unsigned int c0(0); c0 < 6; ++c0)
+			{
+				Math::vec2<float> local{ corners[c0][0], corners[c0][1] };
+				*_p++ = { local * _radius, local, { float(_material), 0 } };
+			}
+		}
+		//_lines vertices of GL_LINES, then _triangles of GL_TRIANGLES
+		inline void scene(Arena const& _arena, Tuning const& _tuning, SceneVertex* _vertices,
+			unsigned int& _lines, unsigned int& _triangles)
+		{
+			SceneVertex* p(_vertices);
+			unsigned int sides(_arena.sides);
+			double scale(_tuning.scale / _arena.R);
+			_lines = sides * 2;
+			_triangles = sides * 6 + 6 + 6;
+			//edge c is coloured like the line loop's provoking vertex c + 1
+			for (unsigned int c0(0); c0 < sides; ++c0)
+				for (unsigned int c1(0); c1 < 2; ++c1)
+					*p++ = { _arena.vertex((c0 + c1) % sides) * scale, { 0, 0 },
+						{ float(BorderMaterial), float((c0 + 1) % sides) } };
+			double h = _arena.h, w(_tuning.playerW / 2);
+			Math::vec2<double> rectangle[4]
+			{
+				{ -w, -h - _tuning.playerH },
+				{ w, -h - _tuning.playerH },
+				{ w, -h },
+				{ -w, -h },
+			};
+			unsigned int const corners[6] = { 0, 1, 2, 3, 0, 2 };
+			for (unsigned int c0(0); c0 < sides; ++c0)
+				for (unsigned int c1(0); c1 < 6; ++c1)
+					*p++ = { _arena.rotate(c0, rectangle[corners[c1]]) * scale, { 0, 0 },
+						{ float(PaddleMaterial), float(c0) } };
+			//point sizes of the old renderers: r0 * scale, and 10 px of windowSize
+			quad(p, scale * _tuning.r0, CircleMaterial);
+			quad(p, 10 / windowSize, BallMaterial);
+		}
+	}
+}
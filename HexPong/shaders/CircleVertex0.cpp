@@ -1,12 +1,21 @@
 #version 450 core
 layout(location = 0) in vec2 position;
-layout(std140, row_major, binding = 0)uniform OffsetBuffer
+layout(std140, row_major, binding = 0)uniform FrameBuffer
 {
-	vec2 offsets[6];
-	uint inversed;
+	vec2 offsets[32];
+	vec2 ball;
+	//per view: rotation (cos, sin) and tile (centre, half size) in clip space
+	vec4 rotations[32];
+	vec4 tiles[32];
 };
+vec4 place(vec2 p)
+{
+	vec4 r = rotations[gl_InstanceID];
+	vec4 t = tiles[gl_InstanceID];
+	vec2 q = vec2(r.x * p.x - r.y * p.y, r.y * p.x + r.x * p.y);
+	return vec4(t.xy + q * t.zw, 0, 1);
+}
 void main()
 {
-	if (inversed == 0)gl_Position = vec4(position, 0, 1);
-	else gl_Position = vec4(-position, 0, 1);
+	gl_Position = place(position);
 }
\ No newline at end of file
@@ -1,17 +1,25 @@
 #version 450 core
 layout(location = 0) in vec2 position;
 //layout(location = 1) in vec3 color;
-layout(std140, row_major, binding = 0)uniform OffsetBuffer
+layout(std140, row_major, binding = 0)uniform FrameBuffer
 {
-	vec2 offsets[6];
-	uint inversed;
+	vec2 offsets[32];
+	vec2 ball;
+	//per view: rotation (cos, sin) and tile (centre, half size) in clip space
+	vec4 rotations[32];
+	vec4 tiles[32];
 };
 //flat out vec4 in_color;
+vec4 place(vec2 p)
+{
+	vec4 r = rotations[gl_InstanceID];
+	vec4 t = tiles[gl_InstanceID];
+	vec2 q = vec2(r.x * p.x - r.y * p.y, r.y * p.x + r.x * p.y);
+	return vec4(t.xy + q * t.zw, 0, 1);
+}
 void main()
 {
-	unsigned int id = gl_VertexID / 6;
-	vec2 temp = position + offsets[id];
-	if (inversed == 0)gl_Position = vec4(temp, 0, 1);
-	else gl_Position = vec4(-temp, 0, 1);
+	int id = gl_VertexID / 6;
+	gl_Position = place(position + offsets[id]);
 	//in_color = vec4(color, 1);
 }
\ No newline at end of file
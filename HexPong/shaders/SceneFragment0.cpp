@@ -0,0 +1,27 @@
+#version 450 core
+in vec2 v_local;
+flat in vec2 v_tag;
+out vec4 o_color;
+//materials: 0 border, 1 paddle, 2 central circle, 3 ball; edge colours repeat every six edges
+const vec3 edgeColors[6] = vec3[6](
+	vec3(0, 1, 1), vec3(0, 0, 1), vec3(127.0 / 255.0, 0, 1),
+	vec3(1, 127.0 / 255.0, 0), vec3(1, 1, 0), vec3(0, 1, 0));
+void main()
+{
+	uint material = uint(v_tag.x + 0.5);
+	if (material == 0u)
+	{
+		o_color = vec4(edgeColors[uint(v_tag.y + 0.5) % 6u], 1);
+		return;
+	}
+	if (material == 1u)
+	{
+		o_color = vec4(0.8, 0.8, 0.8, 1);
+		return;
+	}
+	vec2 temp = v_local * 0.5;
+	float t = dot(temp, temp);
+	if (t > 0.25)discard;
+	if (material == 2u)o_color = mix(vec4(0, 0, 0, 0), vec4(0, 0, 1, 1), smoothstep(0., 0.25, t));
+	else o_color = mix(vec4(0.5, 0.5, 0, 0), vec4(1, 1, 0, 1), smoothstep(0., 0.25, t));
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#version 450 core
+layout(location = 0) in vec2 position;
+layout(location = 1) in vec2 local;
+//material, index (edge colour or seat) as floats
+layout(location = 2) in vec2 tag;
+//arrays sized for maxSides (HexPongCore/Arena.h)
+layout(std140, row_major, binding = 0)uniform FrameBuffer
+{
+	vec2 offsets[32];
+	vec2 ball;
+	//per view: rotation (cos, sin) and tile (centre, half size) in clip space
+	vec4 rotations[32];
+	vec4 tiles[32];
+};
+out vec2 v_local;
+flat out vec2 v_tag;
+vec4 place(vec2 p)
+{
+	vec4 r = rotations[gl_InstanceID];
+	vec4 t = tiles[gl_InstanceID];
+	vec2 q = vec2(r.x * p.x - r.y * p.y, r.y * p.x + r.x * p.y);
+	return vec4(t.xy + q * t.zw, 0, 1);
+}
+void main()
+{
+	uint material = uint(tag.x + 0.5);
+	vec2 temp = position;
+	if (material == 1u)temp += offsets[uint(tag.y + 0.5)];
+	else if (material == 3u)temp += ball;
+	gl_Position = place(temp);
+	v_local = local;
+	v_tag = tag;
+}
\ No newline at end of file
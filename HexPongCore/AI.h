@@ -0,0 +1,201 @@
+#pragma once
+#include <HexPongCore/Physics.h>
+
+namespace Pong
+{
+	struct EasyAI :Player
+	{
+		Physics* physics;
+		unsigned int id;
+		EasyAI(Physics* _physics, unsigned int _id)
+			:
+			physics(_physics),
+			id(_id)
+		{
+
+		}
+		//_n is the inward normal of line
+		static Movement decide(Math::vec2<double> r, Physics::LineSegment const& line, Math::vec2<double> _n, double pos)
+		{
+			Physics::LineSegment dr(r, r + _n);
+			double t2 = dr.intersect(line).t2;
+
+			if (t2 >= -0.1 && t2 <= 1.1)
+			{
+				double target(t2 * 2 - 1);
+				if (target > pos)return Right;
+				else return Left;
+			}
+			else
+			{
+				if (pos > 0)return Left;
+				else return Right;
+			}
+		}
+		virtual Movement update()override
+		{
+			return decide(physics->r, physics->lines[id], physics->arena.normal(id), physics->inputs[id].pos);
+		}
+	};
+	struct BrutalAI :Player
+	{
+		Physics* physics;
+		unsigned int id;
+
+		BrutalAI(Physics* _physics, unsigned int _id)
+			:
+			physics(_physics),
+			id(_id)
+		{
+
+		}
+		static Movement decide(double t1, double t2, double pos)
+		{
+			if (t2 >= -0.5 && t2 <= 1.5 && t1 > 0)
+			{
+				double target(t2 * 2 - 1);
+				if (target > pos)return Right;
+				else return Left;
+			}
+			else
+			{
+				if (pos > 0)return Left;
+				else return Right;
+			}
+		}
+		virtual Movement update()override
+		{
+			Physics::LineSegment::Intersection const& it(physics->intersection(id));
+			return decide(it.t1, it.t2, physics->inputs[id].pos);
+		}
+	};
+
+	// Follows the ball's real trajectory instead of its straight-line step:
+	// a private Physics is forked from the current state and stepped with
+	// every paddle held still, through gravity and bounces off the other
+	// edges (at most maxBounces of them, since the paddles will have moved
+	// by then), until the ball crosses this AI's edge. That crossing is cached
+	// until a bounce or a point changes v (any its[] hit in the current step),
+	// then predicted again. The search runs at most stepsPerFrame steps per
+	// update, resuming next frame, and gives up after horizon steps; while it
+	// runs the AI plays like BrutalAI.
+	struct PredictiveAI :Player
+	{
+		Physics* physics;
+		unsigned int id;
+		unsigned int stepsPerFrame;
+		unsigned int horizon;
+		unsigned int maxBounces;
+		Physics sim;
+		unsigned int steps;
+		unsigned int bounces;
+		bool stale;
+		bool searching;
+		bool found;
+		double target;
+
+		PredictiveAI(Physics* _physics, unsigned int _id, unsigned int _stepsPerFrame = 64, unsigned int _horizon = 1024, unsigned int _maxBounces = 1)
+			:
+			physics(_physics),
+			id(_id),
+			stepsPerFrame(_stepsPerFrame),
+			horizon(_horizon),
+			maxBounces(_maxBounces),
+			sim(),
+			steps(0),
+			bounces(0),
+			stale(true),
+			searching(false),
+			found(false),
+			target(0)
+		{
+		}
+		//drops the prediction, e.g. after the state was replaced out of band
+		void forget()
+		{
+			stale = true;
+			searching = false;
+		}
+		void fork()
+		{
+			if (sim.arena.sides != physics->arena.sides)sim.shape(physics->arena.sides);
+			sim.restore(physics->state());
+			sim.ccd = physics->ccd;
+			sim.integrator = physics->integrator;
+			if (sim.tuning != physics->tuning)sim.tune(physics->tuning);
+			steps = 0;
+			bounces = 0;
+			stale = false;
+			searching = true;
+			found = false;
+		}
+		//advances the fork by at most _budget steps
+		void search(unsigned int _budget)
+		{
+			for (; _budget; --_budget)
+			{
+				if (steps++ == horizon)break;
+				Math::vec2<double> r1(sim.integrate());
+				if (sim.its[id].intersected)
+				{
+					found = true;
+					target = sim.its[id].t2 * 2 - 1;
+					break;
+				}
+				if (sim.crossed && bounces++ == maxBounces)break;
+				sim.collide(r1);
+				if (sim.ended)break;
+			}
+			//budget left over means the loop stopped on its own
+			if (_budget)searching = false;
+		}
+		static Movement approach(double _target, double _pos, double _dt = dt, double _speed = playerSpeed)
+		{
+			double d(_target - _pos);
+			if (fabs(d) < _speed * _dt)return Stop;
+			return d > 0 ? Right : Left;
+		}
+		//BrutalAI's move, while there is no prediction to follow
+		Movement fallback(double _pos)
+		{
+			Physics::LineSegment::Intersection const& it(physics->intersection(id));
+			return BrutalAI::decide(it.t1, it.t2, _pos);
+		}
+		virtual Movement update()override
+		{
+			bool bouncing(physics->crossed != 0);
+			double pos(physics->inputs[id].pos);
+			if (bouncing)
+			{
+				forget();
+				return fallback(pos);
+			}
+			if (stale)fork();
+			if (searching)search(stepsPerFrame);
+			if (searching)return fallback(pos);
+			return approach(found ? target : 0, pos, physics->tick(), physics->tuning.playerSpeed);
+		}
+	};
+
+	enum SeatKind
+	{
+		StopSeat = 'S',
+		EasySeat = 'E',
+		BrutalSeat = 'B',
+		PredictiveSeat = 'P',
+	};
+	inline bool validSeat(char _code)
+	{
+		return _code == StopSeat || _code == EasySeat || _code == BrutalSeat || _code == PredictiveSeat;
+	}
+	inline Player* createPlayer(SeatKind _kind, Physics* _physics, unsigned int _id)
+	{
+		switch (_kind)
+		{
+		case EasySeat:return new EasyAI(_physics, _id);
+		case BrutalSeat:return new BrutalAI(_physics, _id);
+		case PredictiveSeat:return new PredictiveAI(_physics, _id);
+		default:return new Player;
+		}
+	}
+}
@@ -0,0 +1,192 @@
+#pragma once
+#include <cmath>
+#include <HexPongCore/Hexagon.h>
+#include <HexPongCore/Math.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace Pong
+{
+	//the most seats an arena can have: one bit per edge in an unsigned int
+	constexpr unsigned int maxSides = 32;
+
+	//what command lines and settings must check before building an Arena
+	inline bool validSides(unsigned int _sides)
+	{
+		return _sides >= 3 && _sides <= maxSides;
+	}
+
+	//index of the lowest set bit of _a, which must not be 0
+	inline unsigned int lowestBit(unsigned int _a)
+	{
+#if defined(_MSC_VER) && !defined(__clang__)
+		unsigned long index;
+		_BitScanForward(&index, _a);
+		return (unsigned int)index;
+#else
+		return (unsigned int)__builtin_ctz(_a);
+#endif
+	}
+
+	// Geometry of a regular polygon arena with unit edges, one edge per
+	// player, laid out like the hexagon: edge c runs from vertex c to vertex
+	// c + 1, is the bottom edge rotated by c * 360 / sides degrees and holds
+	// the paddle of player c. The tables are filled once per shape, so the
+	// step still never calls sin/cos; with six sides they are the Hexagon
+	// constants, which keeps hexagon matches bit-identical.
+	struct Arena
+	{
+		unsigned int sides;
+		//the apothem, the distance from the centre to every edge
+		double h;
+		//the circumradius, the distance from the centre to every vertex
+		double R;
+		double cosines[maxSides];
+		double sines[maxSides];
+		double vertices[maxSides][2];
+		//pseudo-angles (see pseudoAngle) of the vertices in ascending order,
+		//from vertex first on, for sector()
+		double corners[maxSides];
+		unsigned int first;
+
+		//_sides outside validSides() is clamped, only so that no table overflows
+		explicit Arena(unsigned int _sides = Hexagon::sides)
+			:
+			sides(_sides < 3 ? 3 : _sides > maxSides ? maxSides : _sides),
+			h(Hexagon::h),
+			R(1),
+			cosines{ 0 },
+			sines{ 0 },
+			vertices{ },
+			corners{ 0 },
+			first(0)
+		{
+			if (sides == Hexagon::sides)
+			{
+				for (unsigned int c0(0); c0 < sides; ++c0)
+				{
+					cosines[c0] = Hexagon::cosines[c0];
+					sines[c0] = Hexagon::sines[c0];
+					vertices[c0][0] = Hexagon::vertices[c0][0];
+					vertices[c0][1] = Hexagon::vertices[c0][1];
+				}
+				return;
+			}
+			double step(2 * Math::Pi / sides);
+			h = 0.5 / tan(Math::Pi / sides);
+			R = 0.5 / sin(Math::Pi / sides);
+			for (unsigned int c0(0); c0 < sides; ++c0)
+			{
+				double a(step * c0), b(a - Math::Pi / 2 - Math::Pi / sides);
+				cosines[c0] = cos(a);
+				sines[c0] = sin(a);
+				vertices[c0][0] = R * cos(b);
+				vertices[c0][1] = R * sin(b);
+			}
+			//the vertices turn counterclockwise, so from the smallest on they ascend
+			for (unsigned int c0(1); c0 < sides; ++c0)
+				if (pseudoAngle(vertex(c0)) < pseudoAngle(vertex(first)))first = c0;
+			for (unsigned int c0(0); c0 < sides; ++c0)
+				corners[c0] = pseudoAngle(vertex((first + c0) % sides));
+		}
+		//a stand-in for atan2 in [0, 4) that grows with the angle, from one
+		//division; _p must not be the origin
+		static double pseudoAngle(Math::vec2<double> _p)
+		{
+			double a(_p[0] / (fabs(_p[0]) + fabs(_p[1])));
+			return _p[1] < 0 ? 3 + a : 1 - a;
+		}
+		//one bit per edge
+		unsigned int all()const
+		{
+			return sides == maxSides ? ~0u : (1u << sides) - 1;
+		}
+		//unit direction of edge c, from vertex c to vertex c + 1
+		Math::vec2<double> tangent(unsigned int _c)const
+		{
+			return Math::vec2<double>{ cosines[_c], sines[_c] };
+		}
+		//unit inward normal of edge c
+		Math::vec2<double> normal(unsigned int _c)const
+		{
+			return Math::vec2<double>{ -sines[_c], cosines[_c] };
+		}
+		Math::vec2<double> vertex(unsigned int _c)const
+		{
+			return Math::vec2<double>{ vertices[_c][0], vertices[_c][1] };
+		}
+		//whether _p lies inside the arena, allowing _slack outside each edge
+		bool inside(Math::vec2<double> _p, double _slack = 0)const
+		{
+			for (unsigned int c0(0); c0 < sides; ++c0)
+				if ((_p[0] - vertices[c0][0]) * -sines[c0] + (_p[1] - vertices[c0][1]) * cosines[c0] < -_slack)
+					return false;
+			return true;
+		}
+		//how far _p lies beyond the line of edge _c (negative inside)
+		double beyond(Math::vec2<double> _p, unsigned int _c)const
+		{
+			return _p[0] * sines[_c] - _p[1] * cosines[_c] - h;
+		}
+		//the edge whose sector, seen from the centre, holds _p; may be a
+		//neighbour of it right at a sector border. Sector c runs from vertex
+		//c to vertex c + 1, so it is found by a binary search for _p's
+		//pseudo-angle among the corners; _p must not be the origin.
+		unsigned int sector(Math::vec2<double> _p)const
+		{
+			if (sides == Hexagon::sides)return Hexagon::sector(_p);
+			double a(pseudoAngle(_p));
+			//m: how many corners lie at or before _p
+			unsigned int m(0);
+			for (unsigned int step(maxSides); step; step >>= 1)
+				if (m + step <= sides && corners[m + step - 1] <= a)m += step;
+			return (first + m + sides - 1) % sides;
+		}
+		// Broad phase for a step _A -> _B: bit c is set unless the step cannot
+		// cross edge c. A crossing needs an end beyond the edge's line, so no
+		// edge is possible while both ends are inside the inscribed circle of
+		// radius h. The lines an end outside it is beyond form one arc of
+		// consecutive edges around its sector, so the sector and its two
+		// neighbours are tested and the arc is followed from there while the
+		// end stays beyond: a few tests for any number of sides, since ends
+		// stay close to the border. _margin absorbs the rounding of the exact
+		// test. A zero-length or non-finite step gets every bit, since the
+		// exact test reports NaNs as crossings.
+		unsigned int candidates(Math::vec2<double> _A, Math::vec2<double> _B, double _margin = 1e-9)const
+		{
+			if (_A[0] == _B[0] && _A[1] == _B[1])return all();
+			double inner((h - _margin) * (h - _margin));
+			unsigned int a(0);
+			for (Math::vec2<double> p : { _A, _B })
+			{
+				double rr(p[0] * p[0] + p[1] * p[1]);
+				if (rr < inner)continue;
+				if (!(rr < 1e300))return all();
+				unsigned int s(sector(p));
+				if (beyond(p, s) > -_margin)a |= 1u << s;
+				unsigned int left(s), right(s);
+				for (unsigned int c0(0); c0 < sides / 2; ++c0)
+				{
+					left = (left + sides - 1) % sides;
+					if (!(beyond(p, left) > -_margin))break;
+					a |= 1u << left;
+				}
+				for (unsigned int c0(0); c0 < sides / 2; ++c0)
+				{
+					right = (right + 1) % sides;
+					if (!(beyond(p, right) > -_margin))break;
+					a |= 1u << right;
+				}
+			}
+			return a;
+		}
+		//rotates _p by c * 360 / sides degrees
+		template<class T>Math::vec2<T> rotate(unsigned int _c, Math::vec2<T> _p)const
+		{
+			return Math::vec2<T>{
+				T(cosines[_c] * _p[0] - sines[_c] * _p[1]),
+					T(sines[_c] * _p[0] + cosines[_c] * _p[1]) };
+		}
+	};
+}
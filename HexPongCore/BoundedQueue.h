@@ -0,0 +1,62 @@
+#pragma once
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace Pong
+{
+	// Fixed-capacity FIFO between one producing and one consuming thread.
+	// push() blocks while the queue is full, so a slow consumer throttles the
+	// producer instead of letting memory grow; pop() blocks while it is empty
+	// and returns false once the queue is closed and drained. blocked counts
+	// the pushes that had to wait.
+	template<class T>struct BoundedQueue
+	{
+		std::mutex mutex;
+		std::condition_variable notFull;
+		std::condition_variable notEmpty;
+		std::deque<T> items;
+		size_t capacity;
+		bool closed;
+		unsigned long long blocked;
+
+		BoundedQueue(size_t _capacity)
+			:
+			mutex(),
+			notFull(),
+			notEmpty(),
+			items(),
+			capacity(_capacity ? _capacity : 1),
+			closed(false),
+			blocked(0)
+		{
+		}
+		void push(T const& _item)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			if (items.size() >= capacity)
+			{
+				++blocked;
+				notFull.wait(lock, [this] {return items.size() < capacity; });
+			}
+			items.push_back(_item);
+			notEmpty.notify_one();
+		}
+		bool pop(T& _item)
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			notEmpty.wait(lock, [this] {return items.size() || closed; });
+			if (items.empty())return false;
+			_item = items.front();
+			items.pop_front();
+			notFull.notify_one();
+			return true;
+		}
+		void close()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			closed = true;
+			notEmpty.notify_all();
+		}
+	};
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/stat.h>
+#include <HexPongCore/Physics.h>
+
+namespace Pong
+{
+	// Tuning from a text file, one "name = value" per line, # comments:
+	//
+	//   G = 0.45
+	//   r0 = 0.08
+	//   playerSpeed = 2.5
+	//
+	// Names are the Tuning members G, r0, playerW, playerH, playerSpeed,
+	// ballSpeed, frameRate, dt and scale; unset ones keep their defaults,
+	// except that ballSpeed and dt follow playerSpeed, playerW and frameRate
+	// through the default formulas unless they are set themselves.
+	namespace Config
+	{
+		inline bool parse(char const* _text, Tuning& _tuning, std::string& _error)
+		{
+			struct Knob
+			{
+				char const* name;
+				double Tuning::* member;
+			};
+			static Knob const knobs[] =
+			{
+				{ "G", &Tuning::G },
+				{ "r0", &Tuning::r0 },
+				{ "playerW", &Tuning::playerW },
+				{ "playerH", &Tuning::playerH },
+				{ "playerSpeed", &Tuning::playerSpeed },
+				{ "ballSpeed", &Tuning::ballSpeed },
+				{ "frameRate", &Tuning::frameRate },
+				{ "dt", &Tuning::dt },
+				{ "scale", &Tuning::scale },
+			};
+			Tuning a;
+			bool ballSpeedSet(false), dtSet(false);
+			unsigned int line(0);
+			for (char const* p(_text); *p;)
+			{
+				++line;
+				char const* end(strchr(p, '\n'));
+				std::string text(p, end ? end - p : strlen(p));
+				p = end ? end + 1 : p + text.size();
+				size_t hash(text.find('#'));
+				if (hash != std::string::npos)text.resize(hash);
+				char name[32], rest[2];
+				double value;
+				int fields(sscanf(text.c_str(), " %31[A-Za-z0-9_] = %lf %1s", name, &value, rest));
+				if (fields == EOF)continue;
+				if (fields != 2)
+				{
+					_error = "line " + std::to_string(line) + ": expected name = number";
+					return false;
+				}
+				Knob const* knob(nullptr);
+				for (Knob const& b : knobs)
+					if (!strcmp(b.name, name))knob = &b;
+				if (!knob)
+				{
+					_error = "line " + std::to_string(line) + ": unknown name " + name;
+					return false;
+				}
+				a.*knob->member = value;
+				ballSpeedSet = ballSpeedSet || knob->member == &Tuning::ballSpeed;
+				dtSet = dtSet || knob->member == &Tuning::dt;
+			}
+			if (!(a.G >= 0 && a.r0 > 0 && a.playerW > 0 && a.playerW < 1 && a.playerH > 0 &&
+				a.playerSpeed > 0 && a.frameRate > 0 && a.scale > 0))
+			{
+				_error = "needs G >= 0, 0 < playerW < 1 and the rest > 0";
+				return false;
+			}
+			if (!ballSpeedSet)a.ballSpeed = Tuning::defaultBallSpeed(a.playerSpeed, a.playerW);
+			if (!dtSet)a.dt = Tuning::defaultDt(a.frameRate);
+			if (!(a.ballSpeed > 0 && a.dt > 0))
+			{
+				_error = "needs ballSpeed > 0 and dt > 0";
+				return false;
+			}
+			a.derive();
+			_tuning = a;
+			return true;
+		}
+		inline bool load(char const* _path, Tuning& _tuning, std::string& _error)
+		{
+			FILE* file(fopen(_path, "rb"));
+			if (!file)
+			{
+				_error = std::string("cannot read ") + _path;
+				return false;
+			}
+			std::string text;
+			char buffer[4096];
+			size_t n;
+			while ((n = fread(buffer, 1, sizeof(buffer), file)))
+				text.append(buffer, n);
+			fclose(file);
+			return parse(text.c_str(), _tuning, _error);
+		}
+
+		// Reloads a config file when its modification time or size changes.
+		// poll() is one stat() call, cheap enough for once a frame.
+		struct Watcher
+		{
+			std::string path;
+			long long stamp;
+			long long size;
+
+			Watcher(char const* _path)
+				:
+				path(_path),
+				stamp(-1),
+				size(-1)
+			{
+			}
+			//true when the file changed and _tuning was reloaded from it; a file
+			//that fails to parse leaves _tuning alone and is reported in _error
+			bool poll(Tuning& _tuning, std::string& _error)
+			{
+				struct stat info;
+				if (stat(path.c_str(), &info))return false;
+				if ((long long)info.st_mtime == stamp && (long long)info.st_size == size)return false;
+				stamp = (long long)info.st_mtime;
+				size = (long long)info.st_size;
+				_error.clear();
+				return load(path.c_str(), _tuning, _error);
+			}
+		};
+	}
+}
@@ -0,0 +1,285 @@
+#pragma once
+#include <cmath>
+#include <HexPongCore/Arena.h>
+#include <HexPongCore/Math.h>
+#if !defined(HEXPONG_SCALAR) && (defined(__AVX__) || defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <immintrin.h>
+#endif
+
+namespace Pong
+{
+	// Packs of doubles the edge kernels are written against. Every operation
+	// is a single correctly rounded IEEE op (no FMA), so all widths produce
+	// exactly what Physics::LineSegment::intersect produces.
+	namespace Simd
+	{
+		struct Scalar
+		{
+			using V = double;
+			using M = bool;
+			static constexpr unsigned int width = 1;
+			static V load(double const* _p) { return *_p; }
+			static void store(double* _p, V _a) { *_p = _a; }
+			static V set1(double _a) { return _a; }
+			static V add(V _a, V _b) { return _a + _b; }
+			static V sub(V _a, V _b) { return _a - _b; }
+			static V mul(V _a, V _b) { return _a * _b; }
+			static V div(V _a, V _b) { return _a / _b; }
+			static V sqrt(V _a) { return ::sqrt(_a); }
+			static M eq(V _a, V _b) { return _a == _b; }
+			static M lt(V _a, V _b) { return _a < _b; }
+			static M gt(V _a, V _b) { return _a > _b; }
+			static M or_(M _a, M _b) { return _a || _b; }
+			static V zeroIf(M _m, V _a) { return _m ? 0 : _a; }
+			static unsigned int bits(M _m) { return _m; }
+		};
+#if !defined(HEXPONG_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+		struct SSE2
+		{
+			using V = __m128d;
+			using M = __m128d;
+			static constexpr unsigned int width = 2;
+			static V load(double const* _p) { return _mm_loadu_pd(_p); }
+			static void store(double* _p, V _a) { _mm_storeu_pd(_p, _a); }
+			static V set1(double _a) { return _mm_set1_pd(_a); }
+			static V add(V _a, V _b) { return _mm_add_pd(_a, _b); }
+			static V sub(V _a, V _b) { return _mm_sub_pd(_a, _b); }
+			static V mul(V _a, V _b) { return _mm_mul_pd(_a, _b); }
+			static V div(V _a, V _b) { return _mm_div_pd(_a, _b); }
+			static V sqrt(V _a) { return _mm_sqrt_pd(_a); }
+			static M eq(V _a, V _b) { return _mm_cmpeq_pd(_a, _b); }
+			static M lt(V _a, V _b) { return _mm_cmplt_pd(_a, _b); }
+			static M gt(V _a, V _b) { return _mm_cmpgt_pd(_a, _b); }
+			static M or_(M _a, M _b) { return _mm_or_pd(_a, _b); }
+			static V zeroIf(M _m, V _a) { return _mm_andnot_pd(_m, _a); }
+			static unsigned int bits(M _m) { return _mm_movemask_pd(_m); }
+		};
+#define HEXPONG_SIMD_SSE2
+#endif
+#if !defined(HEXPONG_SCALAR) && defined(__AVX__)
+		struct AVX
+		{
+			using V = __m256d;
+			using M = __m256d;
+			static constexpr unsigned int width = 4;
+			static V load(double const* _p) { return _mm256_loadu_pd(_p); }
+			static void store(double* _p, V _a) { _mm256_storeu_pd(_p, _a); }
+			static V set1(double _a) { return _mm256_set1_pd(_a); }
+			static V add(V _a, V _b) { return _mm256_add_pd(_a, _b); }
+			static V sub(V _a, V _b) { return _mm256_sub_pd(_a, _b); }
+			static V mul(V _a, V _b) { return _mm256_mul_pd(_a, _b); }
+			static V div(V _a, V _b) { return _mm256_div_pd(_a, _b); }
+			static V sqrt(V _a) { return _mm256_sqrt_pd(_a); }
+			static M eq(V _a, V _b) { return _mm256_cmp_pd(_a, _b, _CMP_EQ_OQ); }
+			static M lt(V _a, V _b) { return _mm256_cmp_pd(_a, _b, _CMP_LT_OQ); }
+			static M gt(V _a, V _b) { return _mm256_cmp_pd(_a, _b, _CMP_GT_OQ); }
+			static M or_(M _a, M _b) { return _mm256_or_pd(_a, _b); }
+			static V zeroIf(M _m, V _a) { return _mm256_andnot_pd(_m, _a); }
+			static unsigned int bits(M _m) { return _mm256_movemask_pd(_m); }
+		};
+		using Best = AVX;
+		constexpr char const* bestName = "AVX";
+#elif defined(HEXPONG_SIMD_SSE2)
+		using Best = SSE2;
+		constexpr char const* bestName = "SSE2";
+#else
+		using Best = Scalar;
+		constexpr char const* bestName = "scalar";
+#endif
+	}
+
+	// The arena borders with direction and length precomputed, padded to
+	// maxSides so one ball displacement is tested against all of them in
+	// steps of the SIMD width: the six hexagon edges take two AVX (three
+	// SSE2) steps. Lanes past count are a harmless unit segment.
+	struct EdgeTable
+	{
+		static constexpr unsigned int padded = maxSides;
+
+		unsigned int count;
+		alignas(32) double ax[padded], ay[padded];
+		alignas(32) double kx[padded], ky[padded];
+		alignas(32) double l[padded];
+
+		EdgeTable()
+			:
+			count(0),
+			ax{ 0 }, ay{ 0 },
+			kx{ 0 }, ky{ 0 },
+			l{ 0 }
+		{
+		}
+		template<class LineSegment>explicit EdgeTable(LineSegment const* _lines, unsigned int _count = Hexagon::sides)
+			:
+			EdgeTable()
+		{
+			count = _count;
+			for (unsigned int c0(0); c0 < padded; ++c0)
+			{
+				if (c0 < count)
+				{
+					double dx(_lines[c0].B[0] - _lines[c0].A[0]);
+					double dy(_lines[c0].B[1] - _lines[c0].A[1]);
+					ax[c0] = _lines[c0].A[0];
+					ay[c0] = _lines[c0].A[1];
+					l[c0] = ::sqrt(dx * dx + dy * dy);
+					kx[c0] = dx / l[c0];
+					ky[c0] = dy / l[c0];
+				}
+				else
+				{
+					kx[c0] = 1;
+					l[c0] = 1;
+				}
+			}
+		}
+		//one bit per edge
+		unsigned int all()const
+		{
+			return count == maxSides ? ~0u : (1u << count) - 1;
+		}
+
+		// Output of the kernels in structure-of-arrays form; bit c of mask is
+		// Intersection::intersected of edge c.
+		struct Hits
+		{
+			alignas(32) double t1[padded], t2[padded];
+			alignas(32) double px[padded], py[padded];
+			unsigned int mask;
+		};
+
+		// One displacement _A -> _B against all edges.
+		template<class P = Simd::Best>void intersect(Math::vec2<double> _A, Math::vec2<double> _B, Hits& _hits)const
+		{
+			using V = typename P::V;
+			using M = typename P::M;
+			double dx1(_B[0] - _A[0]), dy1(_B[1] - _A[1]);
+			double l1s(::sqrt(dx1 * dx1 + dy1 * dy1));
+			V l1(P::set1(l1s));
+			V k1x(P::set1(dx1 / l1s)), k1y(P::set1(dy1 / l1s));
+			V Ax(P::set1(_A[0])), Ay(P::set1(_A[1]));
+			V zero(P::set1(0)), two(P::set1(2));
+			_hits.mask = 0;
+			for (unsigned int c0(0); c0 < count; c0 += P::width)
+			{
+				V bAx(P::load(ax + c0)), bAy(P::load(ay + c0));
+				V k2x(P::load(kx + c0)), k2y(P::load(ky + c0));
+				V l2(P::load(l + c0));
+				V dx(P::sub(Ax, bAx)), dy(P::sub(Ay, bAy));
+				V s(P::sub(P::mul(k2x, k1y), P::mul(k1x, k2y)));
+				M parallel(P::eq(s, zero));
+				V t1(P::div(P::sub(P::mul(dx, k2y), P::mul(k2x, dy)), s));
+				V t2(P::div(P::sub(P::mul(dx, k1y), P::mul(k1x, dy)), s));
+				V px(P::div(P::add(P::add(P::add(Ax, P::mul(k1x, t1)), bAx), P::mul(k2x, t2)), two));
+				V py(P::div(P::add(P::add(P::add(Ay, P::mul(k1y, t1)), bAy), P::mul(k2y, t2)), two));
+				M outside(P::or_(P::or_(P::lt(t1, zero), P::gt(t1, l1)), P::or_(P::lt(t2, zero), P::gt(t2, l2))));
+				P::store(_hits.t1 + c0, P::zeroIf(parallel, t1));
+				P::store(_hits.t2 + c0, P::zeroIf(parallel, t2));
+				P::store(_hits.px + c0, P::zeroIf(parallel, px));
+				P::store(_hits.py + c0, P::zeroIf(parallel, py));
+				_hits.mask |= (~P::bits(P::or_(parallel, outside)) & ((1u << P::width) - 1)) << c0;
+			}
+			_hits.mask &= all();
+		}
+		// Same as above, written into Physics::LineSegment::Intersection[count];
+		// returns the mask.
+		template<class Intersection, class P = Simd::Best>unsigned int intersect(Math::vec2<double> _A, Math::vec2<double> _B, Intersection* _its)const
+		{
+			Hits hits;
+			intersect<P>(_A, _B, hits);
+			for (unsigned int c0(0); c0 < count; ++c0)
+			{
+				_its[c0].intersected = (hits.mask >> c0) & 1;
+				_its[c0].t1 = hits.t1[c0];
+				_its[c0].t2 = hits.t2[c0];
+				_its[c0].point = Math::vec2<double>{ hits.px[c0], hits.py[c0] };
+			}
+			return hits.mask;
+		}
+
+		// One displacement, normalized once, for the per-edge kernel below.
+		struct Ray
+		{
+			double ax, ay;
+			double kx, ky;
+			double l;
+		};
+		static Ray ray(Math::vec2<double> _A, Math::vec2<double> _B)
+		{
+			double dx1(_B[0] - _A[0]), dy1(_B[1] - _A[1]);
+			double l1(::sqrt(dx1 * dx1 + dy1 * dy1));
+			return Ray{ _A[0], _A[1], dx1 / l1, dy1 / l1, l1 };
+		}
+		// Edge _c alone, with the operations of the kernels above in the same
+		// order, so it reproduces their result for that edge bit for bit.
+		template<class Intersection>void intersect(Ray const& _ray, unsigned int _c, Intersection& _it)const
+		{
+			double dx(_ray.ax - ax[_c]), dy(_ray.ay - ay[_c]);
+			double s(kx[_c] * _ray.ky - _ray.kx * ky[_c]);
+			if (s == 0)
+			{
+				_it.intersected = false;
+				_it.t1 = 0;
+				_it.t2 = 0;
+				_it.point = Math::vec2<double>{ 0, 0 };
+				return;
+			}
+			double t1((dx * ky[_c] - kx[_c] * dy) / s);
+			double t2((dx * _ray.ky - _ray.kx * dy) / s);
+			_it.t1 = t1;
+			_it.t2 = t2;
+			_it.point = Math::vec2<double>{
+				(_ray.ax + _ray.kx * t1 + ax[_c] + kx[_c] * t2) / 2,
+				(_ray.ay + _ray.ky * t1 + ay[_c] + ky[_c] * t2) / 2 };
+			_it.intersected = !(t1 < 0 || t1 > _ray.l || t2 < 0 || t2 > l[_c]);
+		}
+
+		// Displacements (_rx, _ry) -> (_r1x, _r1y) of _n matches against all
+		// edges, vectorized across matches. Outputs are indexed [edge][match].
+		template<class P = Simd::Best>void intersect(unsigned int _n,
+			double const* _rx, double const* _ry, double const* _r1x, double const* _r1y,
+			double* const* _t1, double* const* _t2, double* const* _px, double* const* _py,
+			unsigned char* const* _intersected)const
+		{
+			unsigned int c0(0);
+			for (; c0 + P::width <= _n; c0 += P::width)
+				intersectLanes<P>(c0, _rx, _ry, _r1x, _r1y, _t1, _t2, _px, _py, _intersected);
+			for (; c0 < _n; ++c0)
+				intersectLanes<Simd::Scalar>(c0, _rx, _ry, _r1x, _r1y, _t1, _t2, _px, _py, _intersected);
+		}
+		template<class P>void intersectLanes(unsigned int _lane,
+			double const* _rx, double const* _ry, double const* _r1x, double const* _r1y,
+			double* const* _t1, double* const* _t2, double* const* _px, double* const* _py,
+			unsigned char* const* _intersected)const
+		{
+			using V = typename P::V;
+			using M = typename P::M;
+			V Ax(P::load(_rx + _lane)), Ay(P::load(_ry + _lane));
+			V dx1(P::sub(P::load(_r1x + _lane), Ax)), dy1(P::sub(P::load(_r1y + _lane), Ay));
+			V l1(P::sqrt(P::add(P::mul(dx1, dx1), P::mul(dy1, dy1))));
+			V k1x(P::div(dx1, l1)), k1y(P::div(dy1, l1));
+			V zero(P::set1(0)), two(P::set1(2));
+			for (unsigned int c0(0); c0 < count; ++c0)
+			{
+				V bAx(P::set1(ax[c0])), bAy(P::set1(ay[c0]));
+				V k2x(P::set1(kx[c0])), k2y(P::set1(ky[c0]));
+				V l2(P::set1(l[c0]));
+				V dx(P::sub(Ax, bAx)), dy(P::sub(Ay, bAy));
+				V s(P::sub(P::mul(k2x, k1y), P::mul(k1x, k2y)));
+				M parallel(P::eq(s, zero));
+				V t1(P::div(P::sub(P::mul(dx, k2y), P::mul(k2x, dy)), s));
+				V t2(P::div(P::sub(P::mul(dx, k1y), P::mul(k1x, dy)), s));
+				V px(P::div(P::add(P::add(P::add(Ax, P::mul(k1x, t1)), bAx), P::mul(k2x, t2)), two));
+				V py(P::div(P::add(P::add(P::add(Ay, P::mul(k1y, t1)), bAy), P::mul(k2y, t2)), two));
+				M outside(P::or_(P::or_(P::lt(t1, zero), P::gt(t1, l1)), P::or_(P::lt(t2, zero), P::gt(t2, l2))));
+				P::store(_t1[c0] + _lane, P::zeroIf(parallel, t1));
+				P::store(_t2[c0] + _lane, P::zeroIf(parallel, t2));
+				P::store(_px[c0] + _lane, P::zeroIf(parallel, px));
+				P::store(_py[c0] + _lane, P::zeroIf(parallel, py));
+				unsigned int hit(~P::bits(P::or_(parallel, outside)));
+				for (unsigned int c1(0); c1 < P::width; ++c1)
+					_intersected[c0][_lane + c1] = (hit >> c1) & 1;
+			}
+		}
+	};
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <chrono>
+
+namespace Pong
+{
+	// Accumulator for running the simulation at a fixed tick rate on the wall
+	// clock, independent of how often it is polled. advance() returns how many
+	// ticks are due since the last call; if more than maxSteps are due (a
+	// stall, a breakpoint) the backlog is dropped instead of caught up, so the
+	// game slows down rather than spiralling. alpha() is how far the clock is
+	// into the next tick, for interpolating between the last two states.
+	struct FixedStep
+	{
+		using Clock = std::chrono::steady_clock;
+
+		double tickTime;
+		unsigned int maxSteps;
+		double accumulator;
+		Clock::time_point last;
+		bool started;
+
+		FixedStep(double _tickRate, unsigned int _maxSteps)
+			:
+			tickTime(1 / _tickRate),
+			maxSteps(_maxSteps),
+			accumulator(0),
+			last(),
+			started(false)
+		{
+		}
+		void setTickRate(double _tickRate)
+		{
+			accumulator *= (1 / _tickRate) / tickTime;
+			tickTime = 1 / _tickRate;
+		}
+		unsigned int advance()
+		{
+			Clock::time_point now(Clock::now());
+			if (!started)
+			{
+				started = true;
+				last = now;
+				return 0;
+			}
+			accumulator += std::chrono::duration<double>(now - last).count();
+			last = now;
+			unsigned int steps(0);
+			while (accumulator >= tickTime && steps < maxSteps)
+			{
+				accumulator -= tickTime;
+				++steps;
+			}
+			if (accumulator >= tickTime)
+				accumulator = 0;
+			return steps;
+		}
+		double alpha()const
+		{
+			return accumulator / tickTime;
+		}
+	};
+}
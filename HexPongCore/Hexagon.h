@@ -0,0 +1,68 @@
+#pragma once
+#include <cmath>
+#include <HexPongCore/Math.h>
+
+namespace Pong
+{
+	// Geometry of the unit regular hexagon arena. Edge c belongs to player c,
+	// runs from vertex c to vertex c + 1 and is the bottom edge rotated by
+	// c * 60 degrees, so every angle the game needs is a multiple of Pi / 3
+	// and all of them are tabulated here instead of calling sin/cos. Arena
+	// is the same layout for any number of sides.
+	namespace Hexagon
+	{
+		constexpr unsigned int sides = 6;
+		//sqrt(3) / 2, the apothem
+		constexpr double h = 0.86602540378443864676;
+
+		constexpr double cosines[sides] = { 1, 0.5, -0.5, -1, -0.5, 0.5 };
+		constexpr double sines[sides] = { 0, h, h, 0, -h, -h };
+
+		constexpr double vertices[sides][2] =
+		{
+			{ -0.5, -h },
+			{ 0.5, -h },
+			{ 1, 0 },
+			{ 0.5, h },
+			{ -0.5, h },
+			{ -1, 0 },
+		};
+
+		//unit direction of edge c, from vertex c to vertex c + 1
+		inline Math::vec2<double> tangent(unsigned int _c)
+		{
+			return Math::vec2<double>{ cosines[_c], sines[_c] };
+		}
+		//unit inward normal of edge c
+		inline Math::vec2<double> normal(unsigned int _c)
+		{
+			return Math::vec2<double>{ -sines[_c], cosines[_c] };
+		}
+		inline Math::vec2<double> vertex(unsigned int _c)
+		{
+			return Math::vec2<double>{ vertices[_c][0], vertices[_c][1] };
+		}
+		//whether _p lies inside the arena, allowing _slack outside each edge
+		inline bool inside(Math::vec2<double> _p, double _slack = 0)
+		{
+			for (unsigned int c0(0); c0 < sides; ++c0)
+				if ((_p[0] - vertices[c0][0]) * -sines[c0] + (_p[1] - vertices[c0][1]) * cosines[c0] < -_slack)
+					return false;
+			return true;
+		}
+		//the edge whose 60 degree sector, seen from the centre, holds _p
+		inline unsigned int sector(Math::vec2<double> _p)
+		{
+			if (fabs(_p[1]) >= 2 * h * fabs(_p[0]))return _p[1] < 0 ? 0 : 3;
+			if (_p[1] < 0)return _p[0] > 0 ? 1 : 5;
+			return _p[0] > 0 ? 2 : 4;
+		}
+		//rotates _p by c * 60 degrees
+		template<class T>Math::vec2<T> rotate(unsigned int _c, Math::vec2<T> _p)
+		{
+			return Math::vec2<T>{
+				T(cosines[_c] * _p[0] - sines[_c] * _p[1]),
+					T(sines[_c] * _p[0] + cosines[_c] * _p[1]) };
+		}
+	}
+}
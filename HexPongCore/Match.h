@@ -0,0 +1,55 @@
+#pragma once
+#include <HexPongCore/Physics.h>
+#include <HexPongCore/Replay.h>
+#include <HexPongCore/Telemetry.h>
+
+namespace Pong
+{
+	struct Match
+	{
+		Physics physics;
+		//one per seat of physics.arena
+		Player* players[maxSides];
+		unsigned long long frames;
+		unsigned long long points;
+		unsigned int losts[maxSides];
+		Replay::Writer* recorder;
+		Telemetry::Ring* telemetry;
+		//frame of the last serve
+		unsigned long long served;
+
+		explicit Match(unsigned int _sides = Hexagon::sides)
+			:
+			physics(_sides),
+			players{ 0 },
+			frames(0),
+			points(0),
+			losts{ 0 },
+			recorder(nullptr),
+			telemetry(nullptr),
+			served(0)
+		{
+		}
+		bool step()
+		{
+			physics.update(players);
+			++frames;
+			if (recorder)recorder->frame(physics);
+			if (telemetry)telemetry->record(physics, frames, frames - served);
+			if (physics.ended)
+			{
+				served = frames;
+				losts[physics.lostPlayer]++;
+				++points;
+				physics.ended = false;
+				physics.init();
+				return true;
+			}
+			return false;
+		}
+		void run(unsigned long long _frames)
+		{
+			while (_frames--)step();
+		}
+	};
+}
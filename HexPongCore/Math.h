@@ -0,0 +1,114 @@
+#pragma once
+#include <cmath>
+
+// The core's only use of the _Math.h library is Math::vec2 and Math::Pi.
+// Where _Math.h is on the include path (MY_INCLUDE, which the game needs
+// for GL/_Window.h anyway) that is used, so that the game sees a single
+// Math::vec2; elsewhere the slice below, with the same operations computed
+// the same way, lets the core and its tools build on their own.
+#if __has_include(<_Math.h>)
+#include <_Math.h>
+#else
+namespace Math
+{
+	constexpr double Pi = 3.14159265358979323846;
+
+	template<class T>struct vec2
+	{
+		T data[2];
+
+		vec2()
+			:
+			data{ 0, 0 }
+		{
+		}
+		vec2(T _a)
+			:
+			data{ _a, _a }
+		{
+		}
+		vec2(T _a, T _b)
+			:
+			data{ _a, _b }
+		{
+		}
+		template<class R>vec2(vec2<R> const& _a)
+			:
+			data{ T(_a.data[0]), T(_a.data[1]) }
+		{
+		}
+		T& operator[](unsigned int _c)
+		{
+			return data[_c];
+		}
+		T const& operator[](unsigned int _c)const
+		{
+			return data[_c];
+		}
+		vec2 operator+(vec2 const& _a)const
+		{
+			return { data[0] + _a.data[0], data[1] + _a.data[1] };
+		}
+		vec2 operator-(vec2 const& _a)const
+		{
+			return { data[0] - _a.data[0], data[1] - _a.data[1] };
+		}
+		vec2 operator-()const
+		{
+			return { -data[0], -data[1] };
+		}
+		vec2 operator*(double _a)const
+		{
+			return { T(data[0] * _a), T(data[1] * _a) };
+		}
+		vec2 operator/(double _a)const
+		{
+			return { T(data[0] / _a), T(data[1] / _a) };
+		}
+		vec2& operator+=(vec2 const& _a)
+		{
+			data[0] += _a.data[0];
+			data[1] += _a.data[1];
+			return *this;
+		}
+		vec2& operator-=(vec2 const& _a)
+		{
+			data[0] -= _a.data[0];
+			data[1] -= _a.data[1];
+			return *this;
+		}
+		vec2& operator*=(double _a)
+		{
+			data[0] *= _a;
+			data[1] *= _a;
+			return *this;
+		}
+		vec2& operator/=(double _a)
+		{
+			data[0] /= _a;
+			data[1] /= _a;
+			return *this;
+		}
+		//dot product
+		T operator,(vec2 const& _a)const
+		{
+			return data[0] * _a.data[0] + data[1] * _a.data[1];
+		}
+		T length()const
+		{
+			return sqrt(data[0] * data[0] + data[1] * data[1]);
+		}
+		vec2& normalize()
+		{
+			T l(length());
+			data[0] /= l;
+			data[1] /= l;
+			return *this;
+		}
+	};
+	template<class T>vec2<T> operator*(double _a, vec2<T> const& _b)
+	{
+		return _b * _a;
+	}
+}
+#endif
@@ -0,0 +1,533 @@
+#pragma once
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include <HexPongCore/Physics.h>
+#include <HexPongCore/StateRing.h>
+
+namespace Pong
+{
+	// Peer-to-peer rollback netplay. Every seat is owned by one peer, which
+	// samples the seat's local Player (keyboard or AI) delay frames ahead and
+	// sends the Movement to every other peer; all peers then simulate the
+	// same inputs. A remote input that has not arrived yet is predicted as a
+	// repeat of its last known one; when it arrives and differs, the session
+	// rewinds its StateRing to that frame and re-simulates up to the present.
+	// A peer stalls rather than predict more than maxPrediction frames ahead
+	// of the slowest remote seat.
+	//
+	// Each packet carries every input the receiver has not acknowledged yet,
+	// so a lost packet is repaired by the next one without retransmission:
+	//   u8 sender, u32 ack, u32 first frame, u8 count,
+	//   2 bits per (frame, owned seat) in frame-major, seat order
+	// ack is the first frame of the sender's seats the receiver has not been
+	// shown to know.
+	namespace Netplay
+	{
+		constexpr unsigned int window = 128;
+		constexpr unsigned char noLoss = 0xff;
+		constexpr unsigned int maxPacket = 10 + (255 * maxSides * 2 + 7) / 8;
+
+		struct Address
+		{
+			unsigned int ip;
+			unsigned short port;
+
+			//"a.b.c.d:port"
+			static bool parse(char const* _text, Address& _address)
+			{
+				unsigned int a, b, c, d, port;
+				if (sscanf(_text, "%u.%u.%u.%u:%u", &a, &b, &c, &d, &port) != 5 ||
+					a > 255 || b > 255 || c > 255 || d > 255 || port > 65535)return false;
+				_address.ip = (a << 24) | (b << 16) | (c << 8) | d;
+				_address.port = (unsigned short)port;
+				return true;
+			}
+			bool operator==(Address const& _a)const
+			{
+				return ip == _a.ip && port == _a.port;
+			}
+		};
+
+		// Non-blocking UDP socket.
+		struct Socket
+		{
+#ifdef _WIN32
+			using Handle = SOCKET;
+			static constexpr Handle invalid = INVALID_SOCKET;
+#else
+			using Handle = int;
+			static constexpr Handle invalid = -1;
+#endif
+			Handle handle;
+
+			Socket()
+				:
+				handle(invalid)
+			{
+#ifdef _WIN32
+				static struct Startup
+				{
+					Startup()
+					{
+						WSADATA data;
+						WSAStartup(MAKEWORD(2, 2), &data);
+					}
+					~Startup()
+					{
+						WSACleanup();
+					}
+				}startup;
+#endif
+			}
+			Socket(Socket const&) = delete;
+			~Socket()
+			{
+				close();
+			}
+			bool open(Address _local)
+			{
+				handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+				if (handle == invalid)return false;
+				sockaddr_in a(toSockaddr(_local));
+				if (bind(handle, (sockaddr*)&a, sizeof(a)))
+				{
+					close();
+					return false;
+				}
+#ifdef _WIN32
+				u_long nonBlocking(1);
+				ioctlsocket(handle, FIONBIO, &nonBlocking);
+#else
+				fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK);
+#endif
+				return true;
+			}
+			void close()
+			{
+				if (handle == invalid)return;
+#ifdef _WIN32
+				closesocket(handle);
+#else
+				::close(handle);
+#endif
+				handle = invalid;
+			}
+			void send(Address _to, unsigned char const* _data, unsigned int _size)
+			{
+				sockaddr_in a(toSockaddr(_to));
+				sendto(handle, (char const*)_data, _size, 0, (sockaddr*)&a, sizeof(a));
+			}
+			//bytes received, 0 when nothing is pending
+			unsigned int receive(unsigned char* _data, unsigned int _size, Address& _from)
+			{
+				sockaddr_in a;
+				socklen_t length(sizeof(a));
+				int n(recvfrom(handle, (char*)_data, _size, 0, (sockaddr*)&a, &length));
+				if (n <= 0)return 0;
+				_from.ip = ntohl(a.sin_addr.s_addr);
+				_from.port = ntohs(a.sin_port);
+				return unsigned(n);
+			}
+			static sockaddr_in toSockaddr(Address _address)
+			{
+				sockaddr_in a;
+				memset(&a, 0, sizeof(a));
+				a.sin_family = AF_INET;
+				a.sin_addr.s_addr = htonl(_address.ip);
+				a.sin_port = htons(_address.port);
+				return a;
+			}
+		};
+
+		// Simulated network between the session and its socket, for testing
+		// on localhost: outgoing packets are dropped with probability loss or
+		// held back for latency ticks plus up to jitter more.
+		struct Link
+		{
+			struct Pending
+			{
+				unsigned long long release;
+				Address to;
+				unsigned int size;
+				unsigned char data[maxPacket];
+			};
+
+			double loss;
+			unsigned int latency;
+			unsigned int jitter;
+			std::mt19937_64 rng;
+			std::deque<Pending> pending;
+			unsigned long long dropped;
+
+			Link(double _loss = 0, unsigned int _latency = 0, unsigned int _jitter = 0, unsigned long long _seed = 1)
+				:
+				loss(_loss),
+				latency(_latency),
+				jitter(_jitter),
+				rng(_seed),
+				pending(),
+				dropped(0)
+			{
+			}
+			void send(unsigned long long _now, Address _to, unsigned char const* _data, unsigned int _size)
+			{
+				if (std::uniform_real_distribution<double>(0, 1)(rng) < loss)
+				{
+					++dropped;
+					return;
+				}
+				Pending a;
+				a.release = _now + latency + (jitter ? rng() % (jitter + 1) : 0);
+				a.to = _to;
+				a.size = _size;
+				memcpy(a.data, _data, _size);
+				pending.push_back(a);
+			}
+			void flush(unsigned long long _now, Socket& _socket)
+			{
+				for (auto c0(pending.begin()); c0 != pending.end();)
+				{
+					if (c0->release <= _now)
+					{
+						_socket.send(c0->to, c0->data, c0->size);
+						c0 = pending.erase(c0);
+					}
+					else ++c0;
+				}
+			}
+		};
+
+		struct Session;
+
+		// A seat as seen by Physics: whatever input the session has for the
+		// frame being simulated, confirmed or predicted.
+		struct NetworkPlayer :Player
+		{
+			Session* session;
+			unsigned int seat;
+
+			NetworkPlayer()
+				:
+				session(nullptr),
+				seat(0)
+			{
+			}
+			virtual Movement update()override;
+		};
+
+		struct Session
+		{
+			Physics* physics;
+			unsigned int me;
+			unsigned int peers;
+			unsigned int owners[maxSides];
+			Address addresses[maxSides];
+			Player* local[maxSides];
+			unsigned int delay;
+			unsigned int maxPrediction;
+			Socket socket;
+			Link* link;
+
+			StateRing<window> ring;
+			Movement inputs[maxSides][window];
+			unsigned long long known[maxSides];
+			unsigned long long acked[maxSides];
+			unsigned long long frame;
+			unsigned long long simulating;
+			unsigned long long rollbackFrom;
+			//the seat that lost in each frame, or noLoss
+			unsigned char lostAt[window];
+			unsigned long long settled;
+			unsigned long long losts[maxSides];
+			NetworkPlayer seats[maxSides];
+			Player* players[maxSides];
+
+			unsigned long long ticks;
+			unsigned long long rollbacks;
+			unsigned long long resimulated;
+			unsigned long long stalls;
+			unsigned long long packetsSent;
+			unsigned long long packetsReceived;
+			unsigned long long bytesSent;
+			double resimulationSeconds;
+
+			Session(Physics* _physics, unsigned int _delay = 2, unsigned int _maxPrediction = 32)
+				:
+				physics(_physics),
+				me(0),
+				peers(0),
+				owners{ 0 },
+				addresses(),
+				local{ 0 },
+				delay(_delay),
+				maxPrediction(_maxPrediction),
+				socket(),
+				link(nullptr),
+				ring(),
+				inputs(),
+				known{ 0 },
+				acked{ 0 },
+				frame(0),
+				simulating(0),
+				rollbackFrom(~0ull),
+				lostAt(),
+				settled(0),
+				losts{ 0 },
+				ticks(0),
+				rollbacks(0),
+				resimulated(0),
+				stalls(0),
+				packetsSent(0),
+				packetsReceived(0),
+				bytesSent(0),
+				resimulationSeconds(0)
+			{
+				for (unsigned int c0(0); c0 < maxSides; ++c0)
+				{
+					seats[c0].session = this;
+					seats[c0].seat = c0;
+					players[c0] = seats + c0;
+				}
+			}
+			// _owners[seat] is the owning peer, _addresses[peer] where it
+			// listens; _local[seat] supplies this peer's seats. The first
+			// delay frames of every seat are Stop.
+			bool open(unsigned int _me, unsigned int _peers, unsigned int const* _owners,
+				Address const* _addresses, Player* const* _local)
+			{
+				if (delay + maxPrediction + 1 >= window || _peers > physics->arena.sides || _me >= _peers)return false;
+				me = _me;
+				peers = _peers;
+				for (unsigned int c0(0); c0 < physics->arena.sides; ++c0)
+				{
+					owners[c0] = _owners[c0];
+					local[c0] = owners[c0] == me ? _local[c0] : nullptr;
+					if (owners[c0] >= peers || (owners[c0] == me && !local[c0]))return false;
+					known[c0] = delay;
+					for (unsigned int c1(0); c1 < delay; ++c1)
+						inputs[c0][c1] = Stop;
+				}
+				for (unsigned int c0(0); c0 < peers; ++c0)
+				{
+					addresses[c0] = _addresses[c0];
+					acked[c0] = 0;
+				}
+				return socket.open(addresses[me]);
+			}
+			//one tick: exchange inputs, repair mispredictions, simulate at most one frame
+			//(none once _limit frames are done); false on a stall
+			bool advance(unsigned long long _limit = ~0ull)
+			{
+				++ticks;
+				receive();
+				if (rollbackFrom < frame)rollback();
+				settle();
+				if (frame >= _limit)
+				{
+					send();
+					return true;
+				}
+				if (frame >= slowest() + maxPrediction)
+				{
+					++stalls;
+					send();
+					return false;
+				}
+				unsigned long long next(frame + delay);
+				for (unsigned int c0(0); c0 < physics->arena.sides; ++c0)
+					if (local[c0])
+					{
+						inputs[c0][next % window] = local[c0]->update();
+						known[c0] = next + 1;
+					}
+				send();
+				simulate();
+				return true;
+			}
+			//first frame some remote seat's input is still missing for
+			unsigned long long slowest()const
+			{
+				unsigned long long a(~0ull);
+				for (unsigned int c0(0); c0 < physics->arena.sides; ++c0)
+					if (!local[c0] && known[c0] < a)a = known[c0];
+				return a;
+			}
+			//first frame any seat's input is still missing for
+			unsigned long long confirmed()const
+			{
+				unsigned long long a(~0ull);
+				for (unsigned int c0(0); c0 < physics->arena.sides; ++c0)
+					if (known[c0] < a)a = known[c0];
+				return a;
+			}
+			Movement input(unsigned int _seat)const
+			{
+				return inputs[_seat][simulating % window];
+			}
+			void simulate()
+			{
+				simulating = frame;
+				ring.save(frame, *physics);
+				for (unsigned int c0(0); c0 < physics->arena.sides; ++c0)
+					if (frame >= known[c0])
+						inputs[c0][frame % window] = known[c0] ? inputs[c0][(known[c0] - 1) % window] : Stop;
+				physics->update(players);
+				lostAt[frame % window] = noLoss;
+				if (physics->ended)
+				{
+					lostAt[frame % window] = (unsigned char)physics->lostPlayer;
+					physics->ended = false;
+					physics->init();
+				}
+				++frame;
+			}
+			void rollback()
+			{
+				auto t0(std::chrono::steady_clock::now());
+				unsigned long long now(frame);
+				ring.rewind(rollbackFrom, *physics);
+				frame = rollbackFrom;
+				while (frame < now)simulate();
+				resimulated += now - rollbackFrom;
+				++rollbacks;
+				rollbackFrom = ~0ull;
+				resimulationSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			}
+			//counts the points of frames whose inputs are all confirmed
+			void settle()
+			{
+				unsigned long long end(confirmed());
+				if (end > frame)end = frame;
+				for (; settled < end; ++settled)
+					if (lostAt[settled % window] != noLoss)
+						++losts[lostAt[settled % window]];
+			}
+			void send()
+			{
+				if (link)link->flush(ticks, socket);
+				unsigned long long mine(~0ull);
+				for (unsigned int c0(0); c0 < physics->arena.sides; ++c0)
+					if (local[c0] && known[c0] < mine)mine = known[c0];
+				if (mine == ~0ull)mine = 0;
+				for (unsigned int c0(0); c0 < peers; ++c0)
+				{
+					if (c0 == me)continue;
+					unsigned long long first(acked[c0] > mine ? mine : acked[c0]);
+					unsigned long long count(mine - first);
+					if (count > 255)
+					{
+						first = mine - 255;
+						count = 255;
+					}
+					unsigned char packet[maxPacket];
+					unsigned int size(encode(packet, c0, first, unsigned(count)));
+					if (link)link->send(ticks, addresses[c0], packet, size);
+					else socket.send(addresses[c0], packet, size);
+					++packetsSent;
+					bytesSent += size;
+				}
+			}
+			//first frame of _peer's seats this session is missing
+			unsigned long long ackFor(unsigned int _peer)const
+			{
+				unsigned long long a(~0ull);
+				for (unsigned int c0(0); c0 < physics->arena.sides; ++c0)
+					if (owners[c0] == _peer && known[c0] < a)a = known[c0];
+				return a == ~0ull ? 0 : a;
+			}
+			unsigned int encode(unsigned char* _packet, unsigned int _to, unsigned long long _first, unsigned int _count)const
+			{
+				_packet[0] = (unsigned char)me;
+				put32(_packet + 1, (unsigned int)ackFor(_to));
+				put32(_packet + 5, (unsigned int)_first);
+				_packet[9] = (unsigned char)_count;
+				unsigned char* bits(_packet + 10);
+				unsigned int bit(0);
+				for (unsigned long long c0(_first); c0 < _first + _count; ++c0)
+					for (unsigned int c1(0); c1 < physics->arena.sides; ++c1)
+						if (local[c1])
+						{
+							if (!(bit & 7))bits[bit >> 3] = 0;
+							bits[bit >> 3] |= (unsigned char)(inputs[c1][c0 % window] << (bit & 7));
+							bit += 2;
+						}
+				return 10 + (bit + 7) / 8;
+			}
+			void receive()
+			{
+				unsigned char packet[maxPacket];
+				Address from;
+				unsigned int size;
+				while ((size = socket.receive(packet, sizeof(packet), from)))
+				{
+					++packetsReceived;
+					if (size < 10 || packet[0] >= peers || packet[0] == me)continue;
+					unsigned int peer(packet[0]);
+					//frame numbers travel as their low 32 bits
+					unsigned long long ack(widen(get32(packet + 1)));
+					unsigned long long first(widen(get32(packet + 5)));
+					unsigned int count(packet[9]);
+					if (ack > acked[peer])acked[peer] = ack;
+					unsigned int bit(0);
+					for (unsigned long long c0(first); c0 < first + count; ++c0)
+						for (unsigned int c1(0); c1 < physics->arena.sides; ++c1)
+						{
+							if (owners[c1] != peer)continue;
+							if ((bit >> 3) + 10 >= size)return;
+							Movement move(Movement((packet[10 + (bit >> 3)] >> (bit & 7)) & 3));
+							bit += 2;
+							if (c0 != known[c1])continue;
+							if (c0 < frame && inputs[c1][c0 % window] != move && c0 < rollbackFrom)
+								rollbackFrom = c0;
+							inputs[c1][c0 % window] = move;
+							known[c1] = c0 + 1;
+						}
+				}
+			}
+			unsigned long long widen(unsigned int _a)const
+			{
+				unsigned long long a((frame & ~0xffffffffull) | _a);
+				if (a > frame + 0x80000000ull && a >= 0x100000000ull)a -= 0x100000000ull;
+				return a;
+			}
+			static void put32(unsigned char* _p, unsigned int _a)
+			{
+				for (unsigned int c0(0); c0 < 4; ++c0)
+					_p[c0] = (unsigned char)(_a >> (8 * c0));
+			}
+			static unsigned int get32(unsigned char const* _p)
+			{
+				return _p[0] | (_p[1] << 8) | (_p[2] << 16) | ((unsigned int)_p[3] << 24);
+			}
+		};
+
+		inline Movement NetworkPlayer::update()
+		{
+			return session->input(seat);
+		}
+	}
+}
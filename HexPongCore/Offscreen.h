@@ -0,0 +1,135 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include <HexPongCore/BoundedQueue.h>
+#include <HexPongCore/Raster.h>
+
+namespace Pong
+{
+	// Turns a running match into video frames as fast as the CPU allows, no
+	// display or GPU involved. The simulation thread push()es the state it
+	// wants drawn; a render thread rasterizes and writes the frames in order,
+	// decoupled by a BoundedQueue that stalls the simulation only when
+	// rendering falls behind by a full queue.
+	// Output:  "-"           raw RGBA frames on stdout (text output moves to
+	//                        stderr), e.g. | ffmpeg -f rawvideo -pix_fmt rgba
+	//                        -s WxH -r 80 -i - out.mp4
+	//          "f%06llu.png" one file per frame; PNG when it ends in .png,
+	//                        raw RGBA otherwise
+	//          anything else one file or pipe of raw RGBA frames
+	struct Offscreen
+	{
+		Raster::Renderer renderer;
+		BoundedQueue<Raster::Frame> queue;
+		std::thread thread;
+		FILE* stream;
+		std::string pattern;
+		bool png;
+		unsigned long long written;
+		double renderSeconds;
+		double writeSeconds;
+		bool failed;
+
+		Offscreen(unsigned int _side, unsigned int _views, unsigned int _sides = Hexagon::sides,
+			Tuning const& _tuning = Tuning(), size_t _capacity = 64)
+			:
+			renderer(_side, _views, _sides, _tuning),
+			queue(_capacity),
+			thread(),
+			stream(nullptr),
+			pattern(),
+			png(false),
+			written(0),
+			renderSeconds(0),
+			writeSeconds(0),
+			failed(false)
+		{
+		}
+		Offscreen(Offscreen const&) = delete;
+		~Offscreen()
+		{
+			close();
+		}
+		bool open(char const* _path)
+		{
+			if (!strcmp(_path, "-"))
+			{
+				fflush(stdout);
+#ifdef _WIN32
+				int fd(_dup(_fileno(stdout)));
+				_setmode(fd, _O_BINARY);
+				_dup2(_fileno(stderr), _fileno(stdout));
+				stream = _fdopen(fd, "wb");
+#else
+				int fd(dup(fileno(stdout)));
+				dup2(fileno(stderr), fileno(stdout));
+				stream = fdopen(fd, "wb");
+#endif
+			}
+			else if (strchr(_path, '%'))
+			{
+				pattern = _path;
+				png = pattern.size() > 4 && !strcmp(pattern.c_str() + pattern.size() - 4, ".png");
+			}
+			else stream = fopen(_path, "wb");
+			if (!stream && pattern.empty())return false;
+			thread = std::thread([this] {work(); });
+			return true;
+		}
+		void push(Physics const& _physics, unsigned long long _index)
+		{
+			queue.push(Raster::Frame::capture(_physics, _index));
+		}
+		void close()
+		{
+			if (!thread.joinable())return;
+			queue.close();
+			thread.join();
+			if (stream)fclose(stream);
+			stream = nullptr;
+		}
+		void work()
+		{
+			Raster::Frame frame;
+			while (queue.pop(frame))
+			{
+				auto t0(std::chrono::steady_clock::now());
+				renderer.render(frame);
+				auto t1(std::chrono::steady_clock::now());
+				if (!failed)write(frame.index);
+				renderSeconds += std::chrono::duration<double>(t1 - t0).count();
+				writeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - t1).count();
+			}
+		}
+		void write(unsigned long long _index)
+		{
+			PONG_PROBE("Offscreen::write");
+			Raster::Image const& image(renderer.image);
+			FILE* file(stream);
+			if (!file)
+			{
+				char name[1024];
+				snprintf(name, sizeof(name), pattern.c_str(), _index);
+				file = fopen(name, "wb");
+				if (!file)
+				{
+					failed = true;
+					return;
+				}
+			}
+			if (png)Raster::writePng(file, image);
+			else if (fwrite(image.rgba.data(), 1, image.rgba.size(), file) != image.rgba.size())failed = true;
+			if (file != stream)fclose(file);
+			++written;
+		}
+	};
+}
@@ -0,0 +1,803 @@
+#pragma once
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <HexPongCore/Arena.h>
+#include <HexPongCore/EdgeKernel.h>
+#include <HexPongCore/Hexagon.h>
+#include <HexPongCore/Math.h>
+#include <HexPongCore/Probe.h>
+
+namespace Pong
+{
+	constexpr double playerW = 0.2;
+	constexpr double playerH = 0.05;
+	constexpr double playerWHalf = playerW / 2;
+	constexpr double frameRate = 80;
+	constexpr double dt = 144 * 0.005 / frameRate;
+	constexpr double dt2 = dt * dt * 0.5;
+	constexpr double G = 0.3;
+	constexpr double r0 = 0.1;
+	constexpr double r03 = r0 * r0 * r0;
+	constexpr double leftLimit = playerW - 1;
+	constexpr double rightLimit = 1 - playerW;
+	constexpr double playerSpeed = 2.0;
+	constexpr double ballSpeed = playerSpeed * 0.9 / rightLimit;
+
+	// The tuning knobs above as a policy for the step: Defaults has them as
+	// compile-time constants, Tuning as plain members that can come from a
+	// config file (see Config.h). Code templated on the policy reads _p.G
+	// either way, so with Defaults every knob folds into the instructions
+	// as before and nothing is loaded per step.
+	struct Defaults
+	{
+		static constexpr double G = Pong::G;
+		static constexpr double r0 = Pong::r0;
+		static constexpr double playerW = Pong::playerW;
+		static constexpr double playerH = Pong::playerH;
+		static constexpr double playerSpeed = Pong::playerSpeed;
+		static constexpr double ballSpeed = Pong::ballSpeed;
+		static constexpr double frameRate = Pong::frameRate;
+		static constexpr double dt = Pong::dt;
+		static constexpr double scale = 0.9;
+		static constexpr double playerWHalf = Pong::playerWHalf;
+		static constexpr double leftLimit = Pong::leftLimit;
+		static constexpr double rightLimit = Pong::rightLimit;
+	};
+	struct Tuning
+	{
+		double G;
+		double r0;
+		double playerW;
+		double playerH;
+		double playerSpeed;
+		double ballSpeed;
+		double frameRate;
+		double dt;
+		//drawing only: the arena's share of a view
+		double scale;
+		double playerWHalf;
+		double leftLimit;
+		double rightLimit;
+
+		Tuning()
+			:
+			G(Defaults::G),
+			r0(Defaults::r0),
+			playerW(Defaults::playerW),
+			playerH(Defaults::playerH),
+			playerSpeed(Defaults::playerSpeed),
+			ballSpeed(Defaults::ballSpeed),
+			frameRate(Defaults::frameRate),
+			dt(Defaults::dt),
+			scale(Defaults::scale),
+			playerWHalf(Defaults::playerWHalf),
+			leftLimit(Defaults::leftLimit),
+			rightLimit(Defaults::rightLimit)
+		{
+		}
+		//the same formulas as the constants, so the defaults come out bit-identical
+		static double defaultDt(double _frameRate)
+		{
+			return 144 * 0.005 / _frameRate;
+		}
+		static double defaultBallSpeed(double _playerSpeed, double _playerW)
+		{
+			return _playerSpeed * 0.9 / (1 - _playerW);
+		}
+		//recomputes the members that follow from playerW
+		void derive()
+		{
+			playerWHalf = playerW / 2;
+			leftLimit = playerW - 1;
+			rightLimit = 1 - playerW;
+		}
+		bool operator==(Tuning const& _a)const
+		{
+			return G == _a.G && r0 == _a.r0 && playerW == _a.playerW && playerH == _a.playerH &&
+				playerSpeed == _a.playerSpeed && ballSpeed == _a.ballSpeed && frameRate == _a.frameRate &&
+				dt == _a.dt && scale == _a.scale;
+		}
+		bool operator!=(Tuning const& _a)const
+		{
+			return !(*this == _a);
+		}
+	};
+
+	enum Movement
+	{
+		Stop = 0,
+		Left = 1,
+		Right = 2,
+	};
+	struct Input
+	{
+		Movement move;
+		double pos;
+
+		Input()
+			:
+			move(Stop),
+			pos(0)
+		{
+		}
+		template<class P>static double advance(P const& _p, double _pos, Movement _move, double _dt)
+		{
+			switch (_move)
+			{
+			case Left:
+				if (_pos > _p.leftLimit)
+				{
+					double tp(_pos - _p.playerSpeed * _dt);
+					_pos = tp < _p.leftLimit ? _p.leftLimit : tp;
+				}
+				break;
+			case Right:
+				if (_pos < _p.rightLimit)
+				{
+					double tp(_pos + _p.playerSpeed * _dt);
+					_pos = tp > _p.rightLimit ? _p.rightLimit : tp;
+				}
+				break;
+			default:
+				break;
+			}
+			return _pos;
+		}
+		static double advance(double _pos, Movement _move, double _dt = dt)
+		{
+			return advance(Defaults(), _pos, _move, _dt);
+		}
+		template<class P>double update(P const& _p, Movement _move, double _dt)
+		{
+			move = _move;
+			return pos = advance(_p, pos, _move, _dt);
+		}
+		double update(Movement _move, double _dt = dt)
+		{
+			return update(Defaults(), _move, _dt);
+		}
+	};
+
+	// How the ball is advanced under the central force over one step h.
+	// Taylor is the original r + v h + a h^2 / 2 with the start-of-step
+	// acceleration; VelocityVerlet and Leapfrog (drift-kick-drift) are
+	// second-order symplectic, RK4 is classic fourth-order Runge-Kutta.
+	enum Integrator
+	{
+		Taylor = 0,
+		VelocityVerlet = 1,
+		Leapfrog = 2,
+		RK4 = 3,
+	};
+
+	// Everything Physics::update reads and writes from one frame to the next.
+	// Trivially copyable and sized for maxSides seats whatever the arena, but
+	// saved and rewound with copy(), which moves only the arena's seats: the
+	// hexagon's 184 live bytes with a fixed-size memcpy, other arenas' with
+	// one sized by their seats. Geometry, settings and the per-step scratch
+	// stay in Physics.
+	struct PhysicsState
+	{
+		Math::vec2<double> r;
+		Math::vec2<double> v;
+		double offsets[maxSides];
+		Input inputs[maxSides];
+		unsigned int lostPlayer;
+		bool ended;
+
+		PhysicsState()
+			:
+			r{ 0.17, 0 },
+			v{ 0, -1.2 * ballSpeed },
+			offsets{ 0 },
+			inputs(),
+			lostPlayer(0),
+			ended(false)
+		{
+		}
+		template<unsigned int N>void copy(PhysicsState const& _from)
+		{
+			r = _from.r;
+			v = _from.v;
+			memcpy(offsets, _from.offsets, N * sizeof(double));
+			memcpy(inputs, _from.inputs, N * sizeof(Input));
+			lostPlayer = _from.lostPlayer;
+			ended = _from.ended;
+		}
+		//_from's first _seats seats; those past them keep their values
+		void copy(PhysicsState const& _from, unsigned int _seats)
+		{
+			if (_seats == Hexagon::sides)
+			{
+				copy<Hexagon::sides>(_from);
+				return;
+			}
+			r = _from.r;
+			v = _from.v;
+			memcpy(offsets, _from.offsets, _seats * sizeof(double));
+			memcpy(inputs, _from.inputs, _seats * sizeof(Input));
+			lostPlayer = _from.lostPlayer;
+			ended = _from.ended;
+		}
+		//bit for bit over the first _seats seats, padding aside
+		bool same(PhysicsState const& _a, unsigned int _seats)const
+		{
+			bool a(!memcmp(&r, &_a.r, sizeof(r)) && !memcmp(&v, &_a.v, sizeof(v)) &&
+				!memcmp(offsets, _a.offsets, _seats * sizeof(double)) &&
+				lostPlayer == _a.lostPlayer && ended == _a.ended);
+			for (unsigned int c0(0); a && c0 < _seats; ++c0)
+				a = inputs[c0].move == _a.inputs[c0].move && !memcmp(&inputs[c0].pos, &_a.inputs[c0].pos, sizeof(double));
+			return a;
+		}
+	};
+	static_assert(std::is_trivially_copyable<PhysicsState>::value, "PhysicsState is saved with memcpy");
+
+	struct Player
+	{
+		virtual ~Player() = default;
+		virtual Movement update()
+		{
+			return Stop;
+		};
+	};
+	struct Physics :PhysicsState
+	{
+		struct LineSegment
+		{
+			using vec2 = Math::vec2<double>;
+			struct Intersection
+			{
+				using vec2 = Math::vec2<double>;
+
+				bool intersected;
+				double t1, t2;
+				vec2 point;
+				Intersection()
+					:
+					intersected(false),
+					t1(0),
+					t2(0),
+					point{ 0 }
+				{
+				}
+			};
+
+			vec2 A, B;
+
+			LineSegment() = default;
+			LineSegment(vec2 _A, vec2 _B)
+				:
+				A(_A),
+				B(_B)
+			{
+
+			}
+			Intersection intersect(LineSegment b)
+			{
+				Intersection r;
+				//the pre-test is the broad phase, Arena::candidates
+				//spelled out per component so that EdgeTable reproduces it bit for bit
+				vec2 d1{ B[0] - A[0], B[1] - A[1] }, d2{ b.B[0] - b.A[0], b.B[1] - b.A[1] };
+				double l1(sqrt(d1[0] * d1[0] + d1[1] * d1[1])), l2(sqrt(d2[0] * d2[0] + d2[1] * d2[1]));
+				vec2 k1{ d1[0] / l1, d1[1] / l1 }, k2{ d2[0] / l2, d2[1] / l2 };
+				vec2 d{ A[0] - b.A[0], A[1] - b.A[1] };
+				double s(k2[0] * k1[1] - k1[0] * k2[1]);
+				if (s == 0)
+				{
+					r.intersected = false;
+					return r;
+				}
+				r.t1 = (d[0] * k2[1] - k2[0] * d[1]) / s;
+				r.t2 = (d[0] * k1[1] - k1[0] * d[1]) / s;
+				r.point = vec2{
+					(A[0] + k1[0] * r.t1 + b.A[0] + k2[0] * r.t2) / 2,
+					(A[1] + k1[1] * r.t1 + b.A[1] + k2[1] * r.t2) / 2 };
+				if (r.t1 < 0 || r.t1 > l1 || r.t2 < 0 || r.t2 > l2)
+					r.intersected = false;
+				else
+					r.intersected = true;
+				return r;
+			}
+		};
+		Arena arena;
+		LineSegment lines[maxSides];
+		EdgeTable edges;
+		// The last step against each edge. Only the edges the broad phase
+		// (Arena::candidates) allows are computed; the others just get
+		// intersected = false, and their t1, t2 and point wait for
+		// intersection(c). itsReady has bit c set where its[c] is complete
+		// and crossed bit c where its[c].intersected is set, so neither
+		// clearing its[] nor finding the first crossing walks every edge.
+		// Up to eight sides, the first edge a seat asks for in a step runs the
+		// full kernel for that step, cheaper there than one per-edge test per
+		// aiming seat; the next step starts from the broad phase again.
+		// itsRay is the step normalized for the per-edge kernel, made once
+		// per step by whichever needs it first (itsRayReady).
+		LineSegment::Intersection its[maxSides];
+		Math::vec2<double> itsFrom;
+		Math::vec2<double> itsTo;
+		EdgeTable::Ray itsRay;
+		bool itsRayReady;
+		unsigned int itsReady;
+		unsigned int crossed;
+		// The paddle contacts of the last update, for telemetry: the edge, the
+		// offset from the paddle centre and v before and after. A loss is the
+		// last one, with v unchanged. CCD can bounce several times per tick;
+		// contacts beyond maxContacts are only counted.
+		struct Contact
+		{
+			unsigned int edge;
+			bool lost;
+			double offset;
+			Math::vec2<double> vIn;
+			Math::vec2<double> vOut;
+		};
+		static constexpr unsigned int maxContacts = 4;
+		Contact contacts[maxContacts];
+		unsigned int contactCount;
+		// Continuous collision mode: each update advances the ball by tick
+		// (which may be several dt) in sub-steps of at most maxStep, shorter
+		// where the ball is within 4 r0 of the centre, resolving every border
+		// crossing at its time of impact so that fast balls neither tunnel nor
+		// lose a second bounce. Off by default; the discrete step above is the
+		// reference behaviour.
+		struct CCD
+		{
+			bool enabled;
+			double tick;
+			double maxStep;
+			double tolerance;
+			unsigned int maxSubsteps;
+
+			CCD()
+				:
+				enabled(false),
+				tick(dt),
+				maxStep(dt),
+				tolerance(0.05),
+				maxSubsteps(64)
+			{
+			}
+		};
+		CCD ccd;
+		unsigned int substeps;
+		Integrator integrator;
+		//set with tune(); while it equals Tuning() the step runs on Defaults
+		Tuning tuning;
+		bool tuned;
+
+		explicit Physics(unsigned int _sides = Hexagon::sides)
+			:
+			PhysicsState(),
+			arena(_sides),
+			edges(),
+			its{},
+			itsFrom(),
+			itsTo(),
+			itsRay(),
+			itsRayReady(false),
+			itsReady(0),
+			crossed(0),
+			contacts{},
+			contactCount(0),
+			ccd(),
+			substeps(0),
+			integrator(Taylor),
+			tuning(),
+			tuned(false)
+		{
+			shape(_sides);
+			init();
+		}
+		//a new arena of _sides seats, which takes effect from the next init()
+		void shape(unsigned int _sides)
+		{
+			arena = Arena(_sides);
+			polygon(arena, lines);
+			edges = EdgeTable(lines, arena.sides);
+			for (unsigned int c0(0); c0 < maxSides; ++c0)
+				its[c0] = LineSegment::Intersection();
+			itsReady = arena.all();
+			crossed = 0;
+		}
+		static void hexagon(LineSegment* _lines)
+		{
+			for (unsigned int c0(0); c0 < 6; ++c0)
+			{
+				_lines[c0].A = Hexagon::vertex(c0);
+				_lines[c0].B = Hexagon::vertex((c0 + 1) % 6);
+			}
+		}
+		static void polygon(Arena const& _arena, LineSegment* _lines)
+		{
+			for (unsigned int c0(0); c0 < _arena.sides; ++c0)
+			{
+				_lines[c0].A = _arena.vertex(c0);
+				_lines[c0].B = _arena.vertex((c0 + 1) % _arena.sides);
+			}
+		}
+		// Runs _f(policy) with Defaults or with tuning, whichever applies:
+		// the one branch per call that lets untuned matches keep constants.
+		template<class F>auto dispatch(F&& _f)
+		{
+			if (tuned)return _f(tuning);
+			return _f(Defaults());
+		}
+		//ccd.tick and ccd.maxStep move with dt while they are still one dt
+		void tune(Tuning const& _tuning)
+		{
+			if (ccd.tick == tuning.dt)ccd.tick = _tuning.dt;
+			if (ccd.maxStep == tuning.dt)ccd.maxStep = _tuning.dt;
+			tuning = _tuning;
+			tuning.derive();
+			tuned = tuning != Tuning();
+		}
+		template<class P>static Math::vec2<double> acceleration(P const& _p, Math::vec2<double> _r)
+		{
+			double rr(_r.length());
+			double rr3(rr * rr * rr);
+			if (rr > _p.r0)return _r * (-_p.G / rr3);
+			else return _r * (2 * _p.G / rr3);
+		}
+		static Math::vec2<double> acceleration(Math::vec2<double> _r)
+		{
+			return acceleration(Defaults(), _r);
+		}
+		//potential of acceleration(), continuous at r0
+		template<class P>static double potential(P const& _p, Math::vec2<double> _r)
+		{
+			double rr(_r.length());
+			if (rr > _p.r0)return -_p.G / rr;
+			else return 2 * _p.G / rr - 3 * _p.G / _p.r0;
+		}
+		static double potential(Math::vec2<double> _r)
+		{
+			return potential(Defaults(), _r);
+		}
+		template<class P>static double energy(P const& _p, Math::vec2<double> _r, Math::vec2<double> _v)
+		{
+			return (_v[0] * _v[0] + _v[1] * _v[1]) / 2 + potential(_p, _r);
+		}
+		static double energy(Math::vec2<double> _r, Math::vec2<double> _v)
+		{
+			return energy(Defaults(), _r, _v);
+		}
+		static Math::vec2<double> propagate(Integrator _integrator, Math::vec2<double> _r, Math::vec2<double>& _v, double _h)
+		{
+			return propagate(Defaults(), _integrator, _r, _v, _h);
+		}
+		//advances _v over _h and returns the new position
+		template<class P>static Math::vec2<double> propagate(P const& _p, Integrator _integrator,
+			Math::vec2<double> _r, Math::vec2<double>& _v, double _h)
+		{
+			using namespace Math;
+			switch (_integrator)
+			{
+			case VelocityVerlet:
+			{
+				vec2<double> a(acceleration(_p, _r));
+				vec2<double> r1 = _r + _v * _h + a * (_h * _h * 0.5);
+				_v += (a + acceleration(_p, r1)) * (_h * 0.5);
+				return r1;
+			}
+			case Leapfrog:
+			{
+				vec2<double> rh = _r + _v * (_h * 0.5);
+				_v += acceleration(_p, rh) * _h;
+				return rh + _v * (_h * 0.5);
+			}
+			case RK4:
+			{
+				vec2<double> k1r(_v), k1v(acceleration(_p, _r));
+				vec2<double> k2r(_v + k1v * (_h * 0.5)), k2v(acceleration(_p, _r + k1r * (_h * 0.5)));
+				vec2<double> k3r(_v + k2v * (_h * 0.5)), k3v(acceleration(_p, _r + k2r * (_h * 0.5)));
+				vec2<double> k4r(_v + k3v * _h), k4v(acceleration(_p, _r + k3r * _h));
+				_v += (k1v + k2v * 2 + k3v * 2 + k4v) * (_h / 6);
+				return _r + (k1r + k2r * 2 + k3r * 2 + k4r) * (_h / 6);
+			}
+			default:
+			{
+				vec2<double> a(acceleration(_p, _r));
+				vec2<double> r1 = _r + _v * _h + a * (_h * _h * 0.5);
+				_v += a * _h;
+				return r1;
+			}
+			}
+		}
+		static Math::vec2<double> bounce(unsigned int _id, double _offset)
+		{
+			return bounce(Defaults(), _id, _offset);
+		}
+		template<class P>static Math::vec2<double> bounce(P const& _p, unsigned int _id, double _offset)
+		{
+			return bounce(_p, Hexagon::tangent(_id), Hexagon::normal(_id), _offset);
+		}
+		//off the edge with unit direction _tau and inward normal _n
+		template<class P>static Math::vec2<double> bounce(P const& _p, Math::vec2<double> _tau, Math::vec2<double> _n, double _offset)
+		{
+			using namespace Math;
+			vec2<double> tau(_tau);
+			vec2<double> n(_n);
+
+			double ita(_offset / _p.playerWHalf);
+			ita = ita * ita / 2;
+			vec2<double> v1(n);
+			if (_offset >= 0)v1 += ita * tau;
+			else v1 -= ita * tau;
+			return v1.normalize();
+		}
+		PhysicsState const& state()const
+		{
+			return *this;
+		}
+		//this arena's seats of the state only
+		void save(PhysicsState& _to)const
+		{
+			_to.copy(*this, arena.sides);
+		}
+		//its[] is rebuilt by the next update, so the state alone resumes the match
+		void restore(PhysicsState const& _state)
+		{
+			copy(_state, arena.sides);
+		}
+		void init()
+		{
+			dispatch([this](auto const& _p) {init(_p); });
+		}
+		template<class P>void init(P const& _p)
+		{
+			//served from the same fraction of the apothem in any arena
+			r = arena.normal(lostPlayer) * (-0.3 * (arena.h / Hexagon::h));
+			v = arena.normal(lostPlayer) * -_p.ballSpeed;
+			for (unsigned int c0(0); c0 < arena.sides; ++c0)
+				inputs[c0].pos = 0;
+			for (unsigned int c0(0); c0 < arena.sides; ++c0)
+				offsets[c0] = inputs[c0].update(_p, Stop, _p.dt);
+		}
+		void update(Player** players)
+		{
+			dispatch([this, players](auto const& _p) {update(_p, players); });
+		}
+		template<class P>void update(P const& _p, Player** players)
+		{
+			PONG_PROBE("Physics::update");
+			Math::vec2<double> r1(integrate(_p));
+			for (unsigned int c0(0); c0 < arena.sides; ++c0)
+			{
+				Movement move;
+				{
+					PONG_PROBE(Probe::seat(c0));
+					move = players[c0]->update();
+				}
+				offsets[c0] = inputs[c0].update(_p, move, tick(_p));
+			}
+			collide(_p, r1);
+		}
+		// Same step with the seat types known at compile time: _players is a
+		// tuple of one player per seat of the arena (or references to them)
+		// whose update() is called non-virtually, so the AI logic inlines
+		// into the step.
+		template<class... Ps>void update(std::tuple<Ps...>& _players)
+		{
+			static_assert(sizeof...(Ps) >= 3 && sizeof...(Ps) <= maxSides, "one player per seat");
+			dispatch([this, &_players](auto const& _p)
+				{
+					PONG_PROBE("Physics::update");
+					Math::vec2<double> r1(integrate(_p));
+					updateSeats(_p, _players, std::index_sequence_for<Ps...>());
+					collide(_p, r1);
+				});
+		}
+		template<class... Ps>void update(std::tuple<Ps...>&& _players)
+		{
+			update(_players);
+		}
+		template<class P>static Movement decide(P& _player)
+		{
+			return _player.P::update();
+		}
+		template<class P, class Tuple, size_t... Is>void updateSeats(P const& _p, Tuple& _players, std::index_sequence<Is...>)
+		{
+			((offsets[Is] = inputs[Is].update(_p, decide(std::get<Is>(_players)), tick(_p))), ...);
+		}
+		double tick()const
+		{
+			return ccd.enabled ? ccd.tick : tuning.dt;
+		}
+		template<class P>double tick(P const& _p)const
+		{
+			return ccd.enabled ? ccd.tick : _p.dt;
+		}
+		Math::vec2<double> integrate()
+		{
+			return dispatch([this](auto const& _p) {return integrate(_p); });
+		}
+		//moves the ball without collisions, fills its[] and returns the new position
+		//(in CCD mode only the straight-line prediction for the AIs; sweep() moves it)
+		template<class P>Math::vec2<double> integrate(P const& _p)
+		{
+			using namespace Math;
+			if (ccd.enabled)
+			{
+				vec2<double> v1(v);
+				vec2<double> r1(propagate(_p, integrator, r, v1, ccd.tick));
+				intersect(r, r1);
+				return r1;
+			}
+			vec2<double> r1(propagate(_p, integrator, r, v, _p.dt));
+			intersect(r, r1);
+			return r1;
+		}
+		//fills its[] for the step _A -> _B, exactly where a crossing is possible
+		void intersect(Math::vec2<double> _A, Math::vec2<double> _B)
+		{
+			itsFrom = _A;
+			itsTo = _B;
+			itsRayReady = false;
+			itsReady = arena.candidates(_A, _B);
+			if (itsReady == arena.all())
+			{
+				crossed = edges.intersect(_A, _B, its);
+				return;
+			}
+			for (unsigned int a(crossed & ~itsReady); a; a &= a - 1)
+				its[lowestBit(a)].intersected = false;
+			crossed = 0;
+			if (!itsReady)return;
+			EdgeTable::Ray const& ray(stepRay());
+			for (unsigned int a(itsReady); a; a &= a - 1)
+			{
+				unsigned int c0(lowestBit(a));
+				edges.intersect(ray, c0, its[c0]);
+				crossed |= (unsigned int)its[c0].intersected << c0;
+			}
+		}
+		EdgeTable::Ray const& stepRay()
+		{
+			if (!itsRayReady)
+			{
+				itsRay = EdgeTable::ray(itsFrom, itsTo);
+				itsRayReady = true;
+			}
+			return itsRay;
+		}
+		//its[_c] with t1, t2 and point, for seats that aim along the step
+		LineSegment::Intersection const& intersection(unsigned int _c)
+		{
+			if (!(itsReady >> _c & 1))
+			{
+				if (arena.sides <= 8)
+				{
+					crossed = edges.intersect(itsFrom, itsTo, its);
+					itsReady = arena.all();
+					return its[_c];
+				}
+				edges.intersect(stepRay(), _c, its[_c]);
+				itsReady |= 1u << _c;
+				//so that the next step clears it like any crossing
+				crossed |= (unsigned int)its[_c].intersected << _c;
+			}
+			return its[_c];
+		}
+		void collide(Math::vec2<double> r1)
+		{
+			dispatch([this, r1](auto const& _p) {collide(_p, r1); });
+		}
+		template<class P>void collide(P const& _p, Math::vec2<double> r1)
+		{
+			using namespace Math;
+			contactCount = 0;
+			if (ccd.enabled)
+			{
+				sweep(_p);
+				return;
+			}
+			bool flag(true);
+			//the first crossed edge
+			if (crossed)
+			{
+				unsigned int c0(lowestBit(crossed));
+				double offset(its[c0].t2 - (offsets[c0] + 1) / 2);
+				vec2<double> vIn(v);
+				if (fabs(offset) < _p.playerWHalf)
+				{
+					v = bounce(_p, arena.tangent(c0), arena.normal(c0), offset);
+					r = its[c0].point + v * (_p.ballSpeed * _p.dt - its[c0].t1);
+					v *= _p.ballSpeed;
+					flag = false;
+				}
+				else
+				{
+					lostPlayer = c0;
+					ended = true;
+				}
+				contact(c0, flag, offset, vIn);
+			}
+			if (flag)r = r1;
+		}
+		void contact(unsigned int _edge, bool _lost, double _offset, Math::vec2<double> _vIn)
+		{
+			if (contactCount < maxContacts)contacts[contactCount] = Contact{ _edge, _lost, _offset, _vIn, v };
+			++contactCount;
+		}
+		template<class P>double substep(P const& _p, Math::vec2<double> _v, double _remaining)const
+		{
+			double h(_remaining < ccd.maxStep ? _remaining : ccd.maxStep);
+			double rr(r.length());
+			double speed(_v.length());
+			if (rr < 4 * _p.r0 && speed > 0)
+			{
+				double limit(ccd.tolerance * rr / speed);
+				double floor(ccd.maxStep / 64);
+				if (limit < floor)limit = floor;
+				if (h > limit)h = limit;
+			}
+			return h;
+		}
+		template<class P>void sweep(P const& _p)
+		{
+			using namespace Math;
+			double remaining(ccd.tick);
+			//bit of the edge just bounced off, which the next sub-step ignores
+			unsigned int skip(0);
+			substeps = 0;
+			while (remaining > 0 && substeps < 4 * ccd.maxSubsteps)
+			{
+				double h(substeps < ccd.maxSubsteps ? substep(_p, v, remaining) : remaining);
+				++substeps;
+				vec2<double> v1(v);
+				vec2<double> r1(propagate(_p, integrator, r, v1, h));
+				//the earliest crossing, the lowest edge on a tie
+				LineSegment::Intersection first;
+				unsigned int edge(maxSides);
+				unsigned int candidates(arena.candidates(r, r1) & ~skip);
+				if (candidates)
+				{
+					EdgeTable::Ray step(EdgeTable::ray(r, r1));
+					for (; candidates; candidates &= candidates - 1)
+					{
+						unsigned int c0(lowestBit(candidates));
+						LineSegment::Intersection it;
+						edges.intersect(step, c0, it);
+						if (it.intersected && (edge == maxSides || it.t1 < first.t1))
+						{
+							edge = c0;
+							first = it;
+						}
+					}
+				}
+				if (edge == maxSides)
+				{
+					v = v1;
+					r = r1;
+					remaining -= h;
+					skip = 0;
+					continue;
+				}
+				double length((r1 - r).length());
+				double hit(length > 0 ? h * (first.t1 / length) : 0);
+				propagate(_p, integrator, r, v, hit);
+				r = first.point;
+				double offset(first.t2 - (offsets[edge] + 1) / 2);
+				vec2<double> vIn(v);
+				if (fabs(offset) < _p.playerWHalf)
+				{
+					v = bounce(_p, arena.tangent(edge), arena.normal(edge), offset) * _p.ballSpeed;
+					contact(edge, false, offset, vIn);
+					remaining -= hit;
+					skip = 1u << edge;
+				}
+				else
+				{
+					lostPlayer = edge;
+					ended = true;
+					contact(edge, true, offset, vIn);
+					return;
+				}
+			}
+		}
+
+	};
+}
@@ -0,0 +1,203 @@
+#pragma once
+#include <vector>
+#include <HexPongCore/Physics.h>
+#include <HexPongCore/AI.h>
+
+namespace Pong
+{
+	// The knobs a parameter sweep varies per lane (see Sweep.h); the rest
+	// stay at their Defaults, so the seats and the step size are shared.
+	struct LaneTuning :Defaults
+	{
+		double G;
+		double r0;
+		double ballSpeed;
+
+		LaneTuning(double _G = Defaults::G, double _r0 = Defaults::r0, double _ballSpeed = Defaults::ballSpeed)
+			:
+			G(_G),
+			r0(_r0),
+			ballSpeed(_ballSpeed)
+		{
+		}
+		//the same knobs for a Physics, which then follows the lane bit for bit
+		Tuning tuning()const
+		{
+			Tuning a;
+			a.G = G;
+			a.r0 = r0;
+			a.ballSpeed = ballSpeed;
+			return a;
+		}
+	};
+
+	// N independent matches in structure-of-arrays layout, stepped in lockstep.
+	// Every lane follows exactly the same arithmetic as Physics::update, so a
+	// lane is bit-identical to a Physics driven by the same seat kinds (and
+	// tuned to the lane's LaneTuning, once any lane was given one). Lanes
+	// play the hexagon; other arenas run on Physics alone.
+	struct PhysicsBatch
+	{
+		using LineSegment = Physics::LineSegment;
+
+		LineSegment lines[6];
+		EdgeTable edges;
+		SeatKind seats[6];
+		unsigned int n;
+		std::vector<double> rx, ry;
+		std::vector<double> vx, vy;
+		std::vector<double> r1x, r1y;
+		std::vector<double> offsets[6];
+		std::vector<double> t1[6], t2[6];
+		std::vector<double> px[6], py[6];
+		std::vector<unsigned char> intersected[6];
+		std::vector<unsigned int> lostPlayer;
+		std::vector<unsigned char> ended;
+		std::vector<LaneTuning> tunings;
+		bool tuned;
+
+		PhysicsBatch(unsigned int _n, SeatKind const* _seats)
+			:
+			n(_n),
+			rx(_n), ry(_n),
+			vx(_n), vy(_n),
+			r1x(_n), r1y(_n),
+			lostPlayer(_n, 0),
+			ended(_n, 0),
+			tunings(_n),
+			tuned(false)
+		{
+			Physics::hexagon(lines);
+			edges = EdgeTable(lines);
+			for (unsigned int c0(0); c0 < 6; ++c0)
+			{
+				seats[c0] = _seats[c0];
+				offsets[c0].resize(_n);
+				t1[c0].resize(_n);
+				t2[c0].resize(_n);
+				px[c0].resize(_n);
+				py[c0].resize(_n);
+				intersected[c0].resize(_n);
+			}
+			for (unsigned int c0(0); c0 < _n; ++c0)
+				init(c0);
+		}
+		//takes effect from the lane's next init()
+		void tune(unsigned int _lane, LaneTuning const& _tuning)
+		{
+			tunings[_lane] = _tuning;
+			tuned = true;
+		}
+		void init(unsigned int _lane)
+		{
+			double speed(tuned ? tunings[_lane].ballSpeed : ballSpeed);
+			Math::vec2<double> n(Hexagon::normal(lostPlayer[_lane]));
+			rx[_lane] = n[0] * -0.3;
+			ry[_lane] = n[1] * -0.3;
+			vx[_lane] = n[0] * -speed;
+			vy[_lane] = n[1] * -speed;
+			for (unsigned int c0(0); c0 < 6; ++c0)
+				offsets[c0][_lane] = Input::advance(0, Stop);
+		}
+		void init(unsigned int _lane, unsigned int _lostPlayer)
+		{
+			lostPlayer[_lane] = _lostPlayer;
+			init(_lane);
+		}
+		//untuned batches keep every knob a constant
+		void update()
+		{
+			if (tuned)update([this](unsigned int _lane)->LaneTuning const& {return tunings[_lane]; });
+			else update([](unsigned int) {return Defaults(); });
+		}
+		//_lane(c) is the policy of lane c
+		template<class L>void update(L const& _lane)
+		{
+			using namespace Math;
+			for (unsigned int c0(0); c0 < n; ++c0)
+			{
+				vec2<double> r{ rx[c0], ry[c0] };
+				vec2<double> v{ vx[c0], vy[c0] };
+				vec2<double> a(Physics::acceleration(_lane(c0), r));
+				vec2<double> r1 = r + v * dt + a * dt2;
+				v += a * dt;
+				vx[c0] = v[0];
+				vy[c0] = v[1];
+				r1x[c0] = r1[0];
+				r1y[c0] = r1[1];
+			}
+			double* t1s[6], * t2s[6], * pxs[6], * pys[6];
+			unsigned char* hits[6];
+			for (unsigned int c1(0); c1 < 6; ++c1)
+			{
+				t1s[c1] = t1[c1].data();
+				t2s[c1] = t2[c1].data();
+				pxs[c1] = px[c1].data();
+				pys[c1] = py[c1].data();
+				hits[c1] = intersected[c1].data();
+			}
+			edges.intersect(n, rx.data(), ry.data(), r1x.data(), r1y.data(), t1s, t2s, pxs, pys, hits);
+			for (unsigned int c1(0); c1 < 6; ++c1)
+				updateSeat(c1);
+			for (unsigned int c0(0); c0 < n; ++c0)
+			{
+				bool flag(true);
+				for (unsigned int c1(0); c1 < 6; ++c1)
+				{
+					if (intersected[c1][c0])
+					{
+						double offset(t2[c1][c0] - (offsets[c1][c0] + 1) / 2);
+						if (fabs(offset) < playerWHalf)
+						{
+							double speed(_lane(c0).ballSpeed);
+							vec2<double> v(Physics::bounce(c1, offset));
+							vec2<double> point{ px[c1][c0], py[c1][c0] };
+							vec2<double> r(point + v * (speed * dt - t1[c1][c0]));
+							v *= speed;
+							rx[c0] = r[0];
+							ry[c0] = r[1];
+							vx[c0] = v[0];
+							vy[c0] = v[1];
+							flag = false;
+						}
+						else
+						{
+							lostPlayer[c0] = c1;
+							ended[c0] = true;
+						}
+						break;
+					}
+				}
+				if (flag)
+				{
+					rx[c0] = r1x[c0];
+					ry[c0] = r1y[c0];
+				}
+			}
+		}
+		void updateSeat(unsigned int _id)
+		{
+			double* pos(offsets[_id].data());
+			switch (seats[_id])
+			{
+			case EasySeat:
+				for (unsigned int c0(0); c0 < n; ++c0)
+					pos[c0] = Input::advance(pos[c0],
+						EasyAI::decide({ rx[c0], ry[c0] }, lines[_id], Hexagon::normal(_id), pos[c0]));
+				break;
+			case BrutalSeat:
+			{
+				double const* t1s(t1[_id].data());
+				double const* t2s(t2[_id].data());
+				for (unsigned int c0(0); c0 < n; ++c0)
+					pos[c0] = Input::advance(pos[c0], BrutalAI::decide(t1s[c0], t2s[c0], pos[c0]));
+				break;
+			}
+			default:
+				for (unsigned int c0(0); c0 < n; ++c0)
+					pos[c0] = Input::advance(pos[c0], Stop);
+				break;
+			}
+		}
+	};
+}
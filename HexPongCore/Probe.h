@@ -0,0 +1,244 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped timing probes: PONG_PROBE("name") times the rest of the enclosing
+// block. They are compiled in only with HEXPONG_PROBES defined; otherwise the
+// macro is an empty statement and nothing here is referenced, so release
+// builds pay nothing.
+#ifdef HEXPONG_PROBES
+#define PONG_PROBE_JOIN2(_a, _b) _a##_b
+#define PONG_PROBE_JOIN(_a, _b) PONG_PROBE_JOIN2(_a, _b)
+#define PONG_PROBE(_name) ::Pong::Probe::Scope PONG_PROBE_JOIN(probe, __LINE__)(_name)
+#else
+#define PONG_PROBE(_name) ((void)0)
+#endif
+
+namespace Pong
+{
+	// Every thread that hits a probe gets its own ring of the newest
+	// capacity events, written without locks or shared cache lines; the
+	// registry mutex is only taken once per thread. Rings outlive their
+	// threads (pool workers), so a report can be taken after they joined.
+	// Extra rings can be made for timelines that are not threads (GPU).
+	namespace Probe
+	{
+#ifdef HEXPONG_PROBES
+		constexpr bool enabled = true;
+#else
+		constexpr bool enabled = false;
+#endif
+		constexpr unsigned int capacity = 1 << 16;
+
+		//ns on the steady clock
+		inline long long now()
+		{
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now().time_since_epoch()).count();
+		}
+
+		struct Event
+		{
+			char const* name;
+			long long begin;
+			long long end;
+		};
+
+		// Single writer; a reader copying while it writes drops the entries
+		// the writer lapped during the copy.
+		struct Ring
+		{
+			std::string label;
+			std::unique_ptr<Event[]> events;
+			std::atomic<unsigned long long> head;
+
+			Ring(std::string const& _label)
+				:
+				label(_label),
+				events(new Event[capacity]),
+				head(0)
+			{
+			}
+			void push(char const* _name, long long _begin, long long _end)
+			{
+				unsigned long long h(head.load(std::memory_order_relaxed));
+				events[h & (capacity - 1)] = Event{ _name, _begin, _end };
+				head.store(h + 1, std::memory_order_release);
+			}
+			void read(std::vector<Event>& _events)const
+			{
+				unsigned long long h0(head.load(std::memory_order_acquire));
+				unsigned long long first(h0 > capacity ? h0 - capacity : 0);
+				size_t size(_events.size());
+				for (unsigned long long c0(first); c0 < h0; ++c0)
+					_events.push_back(events[c0 & (capacity - 1)]);
+				//the writer may be midway through entry h1, which reuses slot h1 - capacity
+				unsigned long long h1(head.load(std::memory_order_acquire));
+				if (h1 + 1 - first > capacity)
+				{
+					unsigned long long lapped(std::min(h1 + 1 - first - capacity, h0 - first));
+					_events.erase(_events.begin() + size, _events.begin() + size + lapped);
+				}
+			}
+		};
+
+		struct Registry
+		{
+			std::mutex mutex;
+			std::vector<std::unique_ptr<Ring>> rings;
+
+			static Registry& get()
+			{
+				static Registry registry;
+				return registry;
+			}
+			Ring* add(std::string const& _label)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				rings.emplace_back(new Ring(_label));
+				return rings.back().get();
+			}
+		};
+
+		inline Ring& local()
+		{
+			static std::atomic<unsigned int> threads(0);
+			thread_local Ring* ring(Registry::get().add("Thread " + std::to_string(threads++)));
+			return *ring;
+		}
+
+		struct Scope
+		{
+			Ring* ring;
+			char const* name;
+			long long begin;
+
+			Scope(char const* _name)
+				:
+				ring(&local()),
+				name(_name),
+				begin(now())
+			{
+			}
+			Scope(Scope const&) = delete;
+			~Scope()
+			{
+				ring->push(name, begin, now());
+			}
+		};
+
+		//per-seat names for probes inside the physics step, for up to 32 seats
+		inline char const* seat(unsigned int _seat)
+		{
+			static struct Names
+			{
+				char text[32][20];
+
+				Names()
+				{
+					for (unsigned int c0(0); c0 < 32; ++c0)
+						snprintf(text[c0], sizeof(text[c0]), "Player %u update", c0);
+				}
+			} const names;
+			return names.text[_seat];
+		}
+
+		struct Stats
+		{
+			std::string name;
+			size_t count;
+			double total;
+			double p50;
+			double p99;
+			double max;
+		};
+
+		// Durations in microseconds over the events still held, one entry per
+		// probe name, heaviest total first.
+		inline std::vector<Stats> summarize()
+		{
+			std::map<std::string, std::vector<double>> durations;
+			Registry& registry(Registry::get());
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			std::vector<Event> events;
+			for (std::unique_ptr<Ring> const& ring : registry.rings)
+			{
+				events.clear();
+				ring->read(events);
+				for (Event const& event : events)
+					durations[event.name].push_back((event.end - event.begin) * 1e-3);
+			}
+			std::vector<Stats> a;
+			for (auto& entry : durations)
+			{
+				std::vector<double>& d(entry.second);
+				std::sort(d.begin(), d.end());
+				double total(0);
+				for (double b : d)total += b;
+				auto rank = [&d](double _q)
+				{
+					return d[std::min(d.size() - 1, size_t(_q * d.size()))];
+				};
+				a.push_back(Stats{ entry.first, d.size(), total, rank(0.5), rank(0.99), d.back() });
+			}
+			std::sort(a.begin(), a.end(), [](Stats const& _a, Stats const& _b) {return _a.total > _b.total; });
+			return a;
+		}
+		inline void print(FILE* _file)
+		{
+			std::vector<Stats> stats(summarize());
+			if (stats.empty())
+			{
+				fprintf(_file, "No probe events%s\n", enabled ? "" : " (built without HEXPONG_PROBES)");
+				return;
+			}
+			fprintf(_file, "%-24s %10s %12s %10s %10s %10s\n", "Probe (us)", "count", "total", "p50", "p99", "max");
+			for (Stats const& a : stats)
+				fprintf(_file, "%-24s %10zu %12.1lf %10.3lf %10.3lf %10.3lf\n",
+					a.name.c_str(), a.count, a.total, a.p50, a.p99, a.max);
+		}
+
+		// Chrome trace-event JSON (chrome://tracing, Perfetto): a complete
+		// ("X") event per probe and one named track per ring.
+		inline bool writeTrace(char const* _path)
+		{
+			FILE* file(fopen(_path, "w"));
+			if (!file)return false;
+			Registry& registry(Registry::get());
+			std::lock_guard<std::mutex> lock(registry.mutex);
+			std::vector<std::vector<Event>> tracks(registry.rings.size());
+			long long origin(0);
+			bool first(true);
+			for (size_t c0(0); c0 < tracks.size(); ++c0)
+			{
+				registry.rings[c0]->read(tracks[c0]);
+				for (Event const& event : tracks[c0])
+					if (first || event.begin < origin)
+					{
+						origin = event.begin;
+						first = false;
+					}
+			}
+			fprintf(file, "{\"traceEvents\":[\n");
+			char const* separator("");
+			for (size_t c0(0); c0 < tracks.size(); ++c0)
+			{
+				fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"%s\"}}",
+					separator, c0, registry.rings[c0]->label.c_str());
+				separator = ",\n";
+				for (Event const& event : tracks[c0])
+					fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%zu,\"ts\":%.3lf,\"dur\":%.3lf}",
+						event.name, c0, (event.begin - origin) * 1e-3, (event.end - event.begin) * 1e-3);
+			}
+			fprintf(file, "\n]}\n");
+			return !fclose(file);
+		}
+	}
+}
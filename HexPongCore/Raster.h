@@ -0,0 +1,321 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <HexPongCore/Physics.h>
+
+namespace Pong
+{
+	// CPU rasterizer for the arena, so that matches can be turned into video
+	// frames on machines with neither a display nor a GPU. It draws what the
+	// game's shaders draw, in the same order and colours: border lines,
+	// paddles, the central circle and the ball, each view rotated so that its
+	// seat is at the bottom and the views laid out side by side (six views in
+	// a 3 x 2 grid, one per seat of larger arenas in a grid about 3:2 wide).
+	// Other arenas than the hexagon are zoomed to fit, as in the game, and
+	// paddles, central circle and scale follow the match's Tuning.
+	namespace Raster
+	{
+		struct Frame
+		{
+			Math::vec2<double> r;
+			double offsets[maxSides];
+			unsigned long long index;
+
+			static Frame capture(Physics const& _physics, unsigned long long _index)
+			{
+				Frame a;
+				a.r = _physics.r;
+				for (unsigned int c0(0); c0 < _physics.arena.sides; ++c0)
+					a.offsets[c0] = _physics.offsets[c0];
+				a.index = _index;
+				return a;
+			}
+		};
+
+		struct Image
+		{
+			unsigned int width;
+			unsigned int height;
+			std::vector<unsigned char> rgba;
+
+			Image(unsigned int _width, unsigned int _height)
+				:
+				width(_width),
+				height(_height),
+				rgba(size_t(_width) * _height * 4, 0)
+			{
+			}
+			void clear()
+			{
+				std::fill(rgba.begin(), rgba.end(), 0);
+				for (size_t c0(3); c0 < rgba.size(); c0 += 4)rgba[c0] = 255;
+			}
+			void put(int _x, int _y, float const* _color)
+			{
+				if (_x < 0 || _y < 0 || _x >= int(width) || _y >= int(height))return;
+				unsigned char* p(rgba.data() + (size_t(_y) * width + _x) * 4);
+				for (unsigned int c0(0); c0 < 3; ++c0)
+					p[c0] = (unsigned char)(_color[c0] * 255 + 0.5f);
+			}
+		};
+
+		// One square view of _side pixels with its lower left corner at
+		// (_x, _y), image rows growing downwards.
+		struct View
+		{
+			Image* image;
+			Arena const* arena;
+			Tuning const* tuning;
+			double x;
+			double y;
+			double side;
+			unsigned int seat;
+
+			//the arena's share of the view: scale with its vertices at 1
+			double zoom()const
+			{
+				return tuning->scale / arena->R;
+			}
+			//arena coordinates to pixel centres
+			Math::vec2<double> map(Math::vec2<double> _p)const
+			{
+				unsigned int back((arena->sides - seat) % arena->sides);
+				Math::vec2<double> q(arena->rotate(back, _p));
+				return Math::vec2<double>{ x + (q[0] * zoom() + 1) / 2 * side,
+					image->height - (y + (q[1] * zoom() + 1) / 2 * side) };
+			}
+			void line(Math::vec2<double> _a, Math::vec2<double> _b, float const* _color)
+			{
+				Math::vec2<double> a(map(_a)), b(map(_b));
+				double dx(b[0] - a[0]), dy(b[1] - a[1]);
+				double length(fabs(dx) > fabs(dy) ? fabs(dx) : fabs(dy));
+				unsigned int steps((unsigned int)ceil(length));
+				for (unsigned int c0(0); c0 <= steps; ++c0)
+				{
+					double t(steps ? double(c0) / steps : 0);
+					image->put(int(floor(a[0] + dx * t)), int(floor(a[1] + dy * t)), _color);
+				}
+			}
+			//convex polygon, either winding
+			void polygon(Math::vec2<double> const* _p, unsigned int _n, float const* _color)
+			{
+				Math::vec2<double> q[8];
+				double x0(1e30), y0(1e30), x1(-1e30), y1(-1e30);
+				for (unsigned int c0(0); c0 < _n; ++c0)
+				{
+					q[c0] = map(_p[c0]);
+					if (q[c0][0] < x0)x0 = q[c0][0];
+					if (q[c0][0] > x1)x1 = q[c0][0];
+					if (q[c0][1] < y0)y0 = q[c0][1];
+					if (q[c0][1] > y1)y1 = q[c0][1];
+				}
+				double area(0);
+				for (unsigned int c0(0); c0 < _n; ++c0)
+				{
+					Math::vec2<double> const& a(q[c0]), & b(q[(c0 + 1) % _n]);
+					area += a[0] * b[1] - b[0] * a[1];
+				}
+				double sign(area < 0 ? -1 : 1);
+				for (int py(int(floor(y0))); py <= int(ceil(y1)); ++py)
+					for (int px(int(floor(x0))); px <= int(ceil(x1)); ++px)
+					{
+						double cx(px + 0.5), cy(py + 0.5);
+						bool inside(true);
+						for (unsigned int c0(0); inside && c0 < _n; ++c0)
+						{
+							Math::vec2<double> const& a(q[c0]), & b(q[(c0 + 1) % _n]);
+							inside = sign * ((b[0] - a[0]) * (cy - a[1]) - (b[1] - a[1]) * (cx - a[0])) >= 0;
+						}
+						if (inside)image->put(px, py, _color);
+					}
+			}
+			//the point-sprite shading: mix(_outer, _inner, smoothstep(0, 0.25, t))
+			//with t = |d / radius|^2 / 4, nothing beyond the radius
+			void disc(Math::vec2<double> _centre, double _radius, float const* _outer, float const* _inner)
+			{
+				Math::vec2<double> c(map(_centre));
+				double radius(_radius * side / 2);
+				for (int py(int(floor(c[1] - radius))); py <= int(ceil(c[1] + radius)); ++py)
+					for (int px(int(floor(c[0] - radius))); px <= int(ceil(c[0] + radius)); ++px)
+					{
+						double dx((px + 0.5 - c[0]) / radius), dy((py + 0.5 - c[1]) / radius);
+						double t((dx * dx + dy * dy) / 4);
+						if (t > 0.25)continue;
+						double s(t / 0.25);
+						s = s * s * (3 - 2 * s);
+						float color[3];
+						for (unsigned int c0(0); c0 < 3; ++c0)
+							color[c0] = float(_outer[c0] + (_inner[c0] - _outer[c0]) * s);
+						image->put(px, py, color);
+					}
+			}
+			void draw(Frame const& _frame)
+			{
+				static float const edgeColors[6][3] =
+				{
+					{ 0, 1, 1 }, { 0, 0, 1 }, { 127 / 255.f, 0, 1 },
+					{ 1, 127 / 255.f, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+				};
+				static float const gray[3] = { 0.8f, 0.8f, 0.8f };
+				static float const black[3] = { 0, 0, 0 };
+				static float const blue[3] = { 0, 0, 1 };
+				static float const olive[3] = { 0.5f, 0.5f, 0 };
+				static float const yellow[3] = { 1, 1, 0 };
+				//edge c in the colour of the line loop's provoking vertex c + 1,
+				//the six colours repeating around larger arenas
+				unsigned int sides(arena->sides);
+				for (unsigned int c0(0); c0 < sides; ++c0)
+					line(arena->vertex(c0), arena->vertex((c0 + 1) % sides), edgeColors[(c0 + 1) % sides % 6]);
+				double w(tuning->playerW / 2), ph(tuning->playerH);
+				for (unsigned int c0(0); c0 < sides; ++c0)
+				{
+					double h(arena->h);
+					Math::vec2<double> shift(arena->tangent(c0) * (0.5 * _frame.offsets[c0]));
+					Math::vec2<double> corners[4]
+					{
+						{ -w, -h - ph },
+						{ w, -h - ph },
+						{ w, -h },
+						{ -w, -h },
+					};
+					for (unsigned int c1(0); c1 < 4; ++c1)
+						corners[c1] = arena->rotate(c0, corners[c1]) + shift;
+					polygon(corners, 4, gray);
+				}
+				disc(Math::vec2<double>{ 0, 0 }, zoom() * tuning->r0, black, blue);
+				disc(_frame.r, 10 / 800.0, olive, yellow);
+			}
+		};
+
+		struct Renderer
+		{
+			Arena arena;
+			Tuning tuning;
+			unsigned int side;
+			unsigned int views;
+			Image image;
+
+			//one row up to two views, else about 3:2 (3 x 2 for six)
+			static unsigned int columns(unsigned int _views)
+			{
+				return _views <= 2 ? _views : (unsigned int)ceil(sqrt(1.5 * _views));
+			}
+			static unsigned int rows(unsigned int _views)
+			{
+				return (_views + columns(_views) - 1) / columns(_views);
+			}
+			Renderer(unsigned int _side, unsigned int _views, unsigned int _sides = Hexagon::sides,
+				Tuning const& _tuning = Tuning())
+				:
+				arena(_sides),
+				tuning(_tuning),
+				side(_side),
+				views(_views),
+				image(_side * columns(_views), _side * rows(_views))
+			{
+			}
+			//1 view: seat 0; 2: seat 0 and the one opposite as in the game
+			//(3 in the hexagon); more: seats 0 to views - 1
+			void render(Frame const& _frame)
+			{
+				PONG_PROBE("Raster::render");
+				image.clear();
+				unsigned int cols(columns(views));
+				for (unsigned int c0(0); c0 < views; ++c0)
+				{
+					unsigned int row(c0 / cols);
+					View view{ &image, &arena, &tuning, double(c0 % cols) * side, double(image.height) - (row + 1.0) * side,
+						double(side), views == 2 ? c0 * (arena.sides / 2) : c0 };
+					view.draw(_frame);
+				}
+			}
+		};
+
+		// PNG with stored (uncompressed) deflate blocks: no zlib needed and
+		// no compression time, at the cost of raw-sized files.
+		inline unsigned int crc32(unsigned int _crc, unsigned char const* _p, size_t _n)
+		{
+			static struct Table
+			{
+				unsigned int entries[256];
+				Table()
+				{
+					for (unsigned int c0(0); c0 < 256; ++c0)
+					{
+						unsigned int c(c0);
+						for (unsigned int c1(0); c1 < 8; ++c1)
+							c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+						entries[c0] = c;
+					}
+				}
+			}const table;
+			_crc = ~_crc;
+			for (size_t c0(0); c0 < _n; ++c0)
+				_crc = table.entries[(_crc ^ _p[c0]) & 0xff] ^ (_crc >> 8);
+			return ~_crc;
+		}
+		inline void writePng(FILE* _file, Image const& _image)
+		{
+			auto be32 = [](unsigned char* _p, unsigned int _a)
+			{
+				_p[0] = _a >> 24; _p[1] = _a >> 16; _p[2] = _a >> 8; _p[3] = _a;
+			};
+			auto chunk = [&](char const* _type, unsigned char const* _data, size_t _n)
+			{
+				unsigned char head[8];
+				be32(head, unsigned(_n));
+				memcpy(head + 4, _type, 4);
+				fwrite(head, 1, 8, _file);
+				if (_n)fwrite(_data, 1, _n, _file);
+				unsigned int crc(crc32(crc32(0, head + 4, 4), _data, _n));
+				be32(head, crc);
+				fwrite(head, 1, 4, _file);
+			};
+			static unsigned char const signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+			fwrite(signature, 1, 8, _file);
+			unsigned char header[13];
+			be32(header, _image.width);
+			be32(header + 4, _image.height);
+			header[8] = 8;
+			header[9] = 6;
+			header[10] = header[11] = header[12] = 0;
+			chunk("IHDR", header, 13);
+
+			size_t row(size_t(_image.width) * 4 + 1), raw(row * _image.height);
+			std::vector<unsigned char> data;
+			data.reserve(raw + raw / 65535 * 5 + 16);
+			data.push_back(0x78);
+			data.push_back(0x01);
+			unsigned int a(1), b(0);
+			size_t done(0), block(0);
+			for (unsigned int c0(0); c0 < _image.height; ++c0)
+				for (size_t c1(0); c1 < row; ++c1)
+				{
+					if (!block)
+					{
+						size_t n(raw - done < 65535 ? raw - done : 65535);
+						data.push_back(raw - done <= 65535);
+						data.push_back((unsigned char)n);
+						data.push_back((unsigned char)(n >> 8));
+						data.push_back((unsigned char)~n);
+						data.push_back((unsigned char)(~n >> 8));
+						block = n;
+					}
+					unsigned char v(c1 ? _image.rgba[(size_t(c0) * _image.width) * 4 + c1 - 1] : 0);
+					data.push_back(v);
+					a = (a + v) % 65521;
+					b = (b + a) % 65521;
+					++done;
+					--block;
+				}
+			unsigned char adler[4];
+			be32(adler, (b << 16) | a);
+			data.insert(data.end(), adler, adler + 4);
+			chunk("IDAT", data.data(), data.size());
+			chunk("IEND", nullptr, 0);
+		}
+	}
+}
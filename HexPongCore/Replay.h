@@ -0,0 +1,418 @@
+#pragma once
+#include <cstdio>
+#include <cstring>
+#include <HexPongCore/Physics.h>
+
+namespace Pong
+{
+	// Compact, append-only replay files. A replay is the initial Physics
+	// state and settings followed by the Movement of every seat for every
+	// Physics::update, run-length encoded (inputs are mostly Stop). Re-running
+	// those inputs through Physics reproduces the match exactly on the same
+	// build, so nothing else is stored; out-of-band changes to the state (a
+	// tournament's serve jitter) are written as keyframes.
+	//
+	// Layout (little-endian, doubles as IEEE 754):
+	//   header   "HXRP", u32 version, u8 integrator, u8 ccd, f64 tick,
+	//            f64 maxStep, f64 tolerance, u32 maxSubsteps, u8 sides,
+	//            char roster[sides], f64 tuning[9] (G, r0, playerW, playerH,
+	//            playerSpeed, ballSpeed, frameRate, dt, scale), State
+	//   State    f64 r[2], f64 v[2], f64 pos[sides], u32 lostPlayer
+	//   records  tag(0, moves)                   one frame
+	//            tag(1, moves), varint count     count frames of the same moves
+	//            tag(2, 0), State                state replaced before next frame
+	//            tag(3, 0), varint frames, State end of replay and final state
+	// moves packs seat c's Movement into bits 2c..2c+1, so a frame where only
+	// seats 0-2 move costs one byte and a held input costs a few per run.
+	// tag(kind, moves) is varint(moves << 2 | kind) split after its first
+	// byte, so that 32 seats' moves still fit: the first byte holds kind and
+	// moves' low five bits (plus the continuation bit), and varint(moves >> 5)
+	// follows when the rest is not zero. Wherever moves << 2 fits 64 bits
+	// (up to 31 seats) that is the same bytes as the plain varint.
+	// Version 2 files (six seats, char roster[8] instead of sides and roster,
+	// State padded to 88 bytes) and version 1 files (also no tuning, which
+	// plays back with the defaults) still play back.
+	namespace Replay
+	{
+		constexpr char magic[4] = { 'H', 'X', 'R', 'P' };
+		constexpr unsigned int version = 3;
+		enum Record
+		{
+			Frame = 0,
+			Run = 1,
+			Keyframe = 2,
+			End = 3,
+		};
+
+		//seats past the arena's are zero
+		struct State
+		{
+			double r[2];
+			double v[2];
+			double pos[maxSides];
+			unsigned int lostPlayer;
+
+			State()
+				:
+				r{ 0 },
+				v{ 0 },
+				pos{ 0 },
+				lostPlayer(0)
+			{
+			}
+			static State capture(Physics const& _physics)
+			{
+				State a;
+				a.r[0] = _physics.r[0];
+				a.r[1] = _physics.r[1];
+				a.v[0] = _physics.v[0];
+				a.v[1] = _physics.v[1];
+				for (unsigned int c0(0); c0 < _physics.arena.sides; ++c0)
+					a.pos[c0] = _physics.inputs[c0].pos;
+				a.lostPlayer = _physics.lostPlayer;
+				return a;
+			}
+			void restore(Physics& _physics)const
+			{
+				_physics.r = Math::vec2<double>{ r[0], r[1] };
+				_physics.v = Math::vec2<double>{ v[0], v[1] };
+				for (unsigned int c0(0); c0 < _physics.arena.sides; ++c0)
+				{
+					_physics.inputs[c0].pos = pos[c0];
+					_physics.offsets[c0] = pos[c0];
+				}
+				_physics.lostPlayer = lostPlayer;
+				_physics.ended = false;
+			}
+			bool operator==(State const& _a)const
+			{
+				return !memcmp(r, _a.r, sizeof(r)) && !memcmp(v, _a.v, sizeof(v)) &&
+					!memcmp(pos, _a.pos, sizeof(pos)) && lostPlayer == _a.lostPlayer;
+			}
+		};
+
+		constexpr double Tuning::* const knobs[9] =
+		{
+			&Tuning::G, &Tuning::r0, &Tuning::playerW, &Tuning::playerH, &Tuning::playerSpeed,
+			&Tuning::ballSpeed, &Tuning::frameRate, &Tuning::dt, &Tuning::scale,
+		};
+
+		inline unsigned long long encode(Physics const& _physics)
+		{
+			unsigned long long code(0);
+			for (unsigned int c0(0); c0 < _physics.arena.sides; ++c0)
+				code |= (unsigned long long)_physics.inputs[c0].move << (2 * c0);
+			return code;
+		}
+
+		struct Writer
+		{
+			FILE* file;
+			unsigned int sides;
+			unsigned long long code;
+			unsigned long long run;
+			unsigned long long frames;
+			//a short write (a full disk); close() reports it
+			bool failed;
+
+			Writer()
+				:
+				file(nullptr),
+				sides(Hexagon::sides),
+				code(0),
+				run(0),
+				frames(0),
+				failed(false)
+			{
+			}
+			Writer(Writer const&) = delete;
+			~Writer()
+			{
+				if (file)fclose(file);
+			}
+			bool open(char const* _path, Physics const& _physics, char const* _roster = "")
+			{
+				file = fopen(_path, "wb");
+				if (!file)return false;
+				failed = false;
+				putBytes(magic, 4);
+				put32(version);
+				put8(_physics.integrator);
+				put8(_physics.ccd.enabled);
+				put(_physics.ccd.tick);
+				put(_physics.ccd.maxStep);
+				put(_physics.ccd.tolerance);
+				put32(_physics.ccd.maxSubsteps);
+				sides = _physics.arena.sides;
+				put8((unsigned char)sides);
+				char roster[maxSides]{ 0 };
+				size_t length(strlen(_roster));
+				memcpy(roster, _roster, length < sides ? length : sides);
+				putBytes(roster, sides);
+				for (double Tuning::* knob : knobs)
+					put(_physics.tuning.*knob);
+				putState(State::capture(_physics));
+				return true;
+			}
+			//after every Physics::update, before a lost point is re-served
+			void frame(Physics const& _physics)
+			{
+				unsigned long long a(encode(_physics));
+				if (run && a != code)flush();
+				code = a;
+				++run;
+				++frames;
+			}
+			//after a change to the state that no input caused (Tournament's serve jitter)
+			void keyframe(Physics const& _physics)
+			{
+				flush();
+				putTag(Keyframe, 0);
+				putState(State::capture(_physics));
+			}
+			//false if any of the file could not be written
+			bool close(Physics const& _physics)
+			{
+				if (!file)return !failed;
+				flush();
+				putTag(End, 0);
+				putVarint(frames);
+				putState(State::capture(_physics));
+				failed = fclose(file) || failed;
+				file = nullptr;
+				return !failed;
+			}
+			void flush()
+			{
+				if (!run)return;
+				if (run == 1)putTag(Frame, code);
+				else
+				{
+					putTag(Run, code);
+					putVarint(run);
+				}
+				run = 0;
+			}
+			void putBytes(void const* _a, size_t _size)
+			{
+				failed = fwrite(_a, 1, _size, file) != _size || failed;
+			}
+			void put8(unsigned char _a)
+			{
+				failed = fputc(_a, file) == EOF || failed;
+			}
+			void put32(unsigned int _a)
+			{
+				putBytes(&_a, sizeof(_a));
+			}
+			template<class T>void put(T const& _a)
+			{
+				putBytes(&_a, sizeof(T));
+			}
+			void putState(State const& _a)
+			{
+				putBytes(_a.r, sizeof(_a.r));
+				putBytes(_a.v, sizeof(_a.v));
+				putBytes(_a.pos, sizeof(double) * sides);
+				put32(_a.lostPlayer);
+			}
+			void putTag(Record _kind, unsigned long long _code)
+			{
+				unsigned long long rest(_code >> 5);
+				put8((unsigned char)(_kind | (_code & 31) << 2 | (rest ? 0x80 : 0)));
+				if (rest)putVarint(rest);
+			}
+			void putVarint(unsigned long long _a)
+			{
+				while (_a >= 0x80)
+				{
+					put8((unsigned char)((_a & 0x7f) | 0x80));
+					_a >>= 7;
+				}
+				put8((unsigned char)_a);
+			}
+		};
+
+		// Plays back recorded inputs; one per seat, all reading the moves the
+		// Reader decoded for the current frame.
+		struct Seat :Player
+		{
+			Movement const* move;
+
+			Seat()
+				:
+				move(nullptr)
+			{
+			}
+			virtual Movement update()override
+			{
+				return *move;
+			}
+		};
+
+		struct Reader
+		{
+			FILE* file;
+			unsigned int version;
+			Physics::CCD ccd;
+			Integrator integrator;
+			unsigned int sides;
+			char roster[maxSides + 1];
+			Tuning tuning;
+			State initial;
+			State final;
+			unsigned long long frames;
+			unsigned long long recorded;
+			unsigned long long code;
+			unsigned long long run;
+			Movement moves[maxSides];
+			Seat seats[maxSides];
+			bool ended;
+
+			Reader()
+				:
+				file(nullptr),
+				version(0),
+				ccd(),
+				integrator(Taylor),
+				sides(Hexagon::sides),
+				roster{ 0 },
+				tuning(),
+				initial(),
+				final(),
+				frames(0),
+				recorded(0),
+				code(0),
+				run(0),
+				moves{ Stop },
+				ended(false)
+			{
+				for (unsigned int c0(0); c0 < maxSides; ++c0)
+					seats[c0].move = moves + c0;
+			}
+			Reader(Reader const&) = delete;
+			~Reader()
+			{
+				if (file)fclose(file);
+			}
+			bool open(char const* _path)
+			{
+				file = fopen(_path, "rb");
+				if (!file)return false;
+				char a[4];
+				if (fread(a, 1, 4, file) != 4 || memcmp(a, magic, 4) || !get(version) || !version ||
+					version > Replay::version)
+					return false;
+				integrator = Integrator(fgetc(file));
+				ccd.enabled = fgetc(file);
+				get(ccd.tick);
+				get(ccd.maxStep);
+				get(ccd.tolerance);
+				get(ccd.maxSubsteps);
+				if (version >= 3)
+				{
+					int n(fgetc(file));
+					if (n < 3 || n > int(maxSides))return false;
+					sides = unsigned(n);
+				}
+				if (fread(roster, 1, version >= 3 ? sides : 8, file) != (version >= 3 ? sides : 8))return false;
+				if (version >= 2)
+				{
+					for (double Tuning::* knob : knobs)
+						if (!get(tuning.*knob))return false;
+					tuning.derive();
+				}
+				return getState(initial);
+			}
+			//puts _physics into the recorded arena, initial state and settings
+			void start(Physics& _physics)const
+			{
+				if (_physics.arena.sides != sides)_physics.shape(sides);
+				_physics.tune(tuning);
+				_physics.integrator = integrator;
+				_physics.ccd = ccd;
+				initial.restore(_physics);
+			}
+			//decodes the next frame's moves into moves[]; false at the end
+			bool next(Physics& _physics)
+			{
+				while (!run)
+				{
+					if (ended)return false;
+					unsigned int kind;
+					unsigned long long tag;
+					if (!getTag(kind, tag))return end();
+					switch (kind)
+					{
+					case Frame:
+						code = tag;
+						run = 1;
+						break;
+					case Run:
+						code = tag;
+						if (!getVarint(run))return end();
+						break;
+					case Keyframe:
+					{
+						State a;
+						if (!getState(a))return end();
+						a.restore(_physics);
+						break;
+					}
+					default:
+						getVarint(recorded);
+						getState(final);
+						return end();
+					}
+				}
+				--run;
+				++frames;
+				for (unsigned int c0(0); c0 < sides; ++c0)
+					moves[c0] = Movement((code >> (2 * c0)) & 3);
+				return true;
+			}
+			bool end()
+			{
+				ended = true;
+				return false;
+			}
+			template<class T>bool get(T& _a)
+			{
+				return fread(&_a, sizeof(T), 1, file) == 1;
+			}
+			//before version 3 the raw struct of six seats, padded to 88 bytes
+			bool getState(State& _a)
+			{
+				_a = State();
+				unsigned int padding;
+				return fread(_a.r, sizeof(double), 2, file) == 2 && fread(_a.v, sizeof(double), 2, file) == 2 &&
+					fread(_a.pos, sizeof(double), sides, file) == sides && get(_a.lostPlayer) &&
+					(version >= 3 || get(padding));
+			}
+			bool getTag(unsigned int& _kind, unsigned long long& _code)
+			{
+				int a(fgetc(file));
+				if (a == EOF)return false;
+				_kind = a & 3;
+				_code = (a >> 2) & 31;
+				if (!(a & 0x80))return true;
+				unsigned long long rest;
+				if (!getVarint(rest))return false;
+				_code |= rest << 5;
+				return true;
+			}
+			bool getVarint(unsigned long long& _a)
+			{
+				_a = 0;
+				for (unsigned int c0(0); c0 < 64; c0 += 7)
+				{
+					int a(fgetc(file));
+					if (a == EOF)return false;
+					_a |= (unsigned long long)(a & 0x7f) << c0;
+					if (!(a & 0x80))return true;
+				}
+				return false;
+			}
+		};
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <HexPongCore/Physics.h>
+
+namespace Pong
+{
+	// The last N PhysicsStates of a match, indexed by frame number, for
+	// rolling back to an earlier frame (netplay corrections) or branching
+	// from it (lookahead). save() the state at the start of each frame;
+	// rewind() restores one and forgets the frames after it. N is a power of
+	// two so that a frame's slot is frame & (N - 1); older frames are
+	// overwritten. Slots hold the seats of the arena that saved them.
+	template<unsigned int N>struct StateRing
+	{
+		static_assert(N && !(N & (N - 1)), "N must be a power of two");
+
+		PhysicsState states[N];
+		unsigned long long newest;
+		unsigned int count;
+
+		StateRing()
+			:
+			states(),
+			newest(0),
+			count(0)
+		{
+		}
+		//saving a frame still held forgets the frames after it (re-simulating
+		//after a rewind); any other frame that does not follow newest starts
+		//a new history
+		void save(unsigned long long _frame, Physics const& _physics)
+		{
+			_physics.save(states[_frame & (N - 1)]);
+			if (count && _frame == newest + 1)
+			{
+				if (count < N)++count;
+			}
+			else if (holds(_frame))count -= unsigned(newest - _frame);
+			else count = 1;
+			newest = _frame;
+		}
+		bool holds(unsigned long long _frame)const
+		{
+			return count && _frame <= newest && newest - _frame < count;
+		}
+		PhysicsState const* find(unsigned long long _frame)const
+		{
+			return holds(_frame) ? states + (_frame & (N - 1)) : nullptr;
+		}
+		//how many frames back rewind() can go from newest
+		unsigned int depth()const
+		{
+			return count ? count - 1 : 0;
+		}
+		bool rewind(unsigned long long _frame, Physics& _physics)
+		{
+			if (!holds(_frame))return false;
+			_physics.restore(states[_frame & (N - 1)]);
+			count -= unsigned(newest - _frame);
+			newest = _frame;
+			return true;
+		}
+		void clear()
+		{
+			count = 0;
+		}
+	};
+}
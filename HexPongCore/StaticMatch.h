@@ -0,0 +1,66 @@
+#pragma once
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <HexPongCore/Physics.h>
+
+namespace Pong
+{
+	// Match with the seat types fixed at compile time, one per seat of an
+	// arena with as many sides, e.g.
+	// StaticMatch<RealPlayer0, BrutalAI, BrutalAI, RealPlayer1, BrutalAI, BrutalAI>.
+	// Seats constructible from (Physics*, seat) get both; others are default
+	// constructed. Match remains the runtime-polymorphic equivalent.
+	template<class... Ps>
+	struct StaticMatch
+	{
+		static_assert(sizeof...(Ps) >= 3 && sizeof...(Ps) <= maxSides, "one player per seat");
+
+		Physics physics;
+		std::tuple<Ps...> players;
+		unsigned long long frames;
+		unsigned long long points;
+		unsigned int losts[sizeof...(Ps)];
+
+		StaticMatch()
+			:
+			StaticMatch(std::index_sequence_for<Ps...>())
+		{
+		}
+		template<size_t... Is>StaticMatch(std::index_sequence<Is...>)
+			:
+			physics(sizeof...(Ps)),
+			players(seat<Ps>(Is)...),
+			frames(0),
+			points(0),
+			losts{ 0 }
+		{
+		}
+		StaticMatch(StaticMatch const&) = delete;
+		template<class P>P seat(unsigned int _id)
+		{
+			if constexpr (std::is_constructible<P, Physics*, unsigned int>::value)
+				return P(&physics, _id);
+			else
+				return P();
+		}
+		bool step()
+		{
+			physics.update(players);
+			++frames;
+			if (physics.ended)
+			{
+				losts[physics.lostPlayer]++;
+				++points;
+				physics.ended = false;
+				physics.init();
+				return true;
+			}
+			return false;
+		}
+		void run(unsigned long long _frames)
+		{
+			while (_frames--)step();
+		}
+	};
+}
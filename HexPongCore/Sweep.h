@@ -0,0 +1,332 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include <HexPongCore/AI.h>
+#include <HexPongCore/Match.h>
+#include <HexPongCore/PhysicsBatch.h>
+#include <HexPongCore/WorkStealing.h>
+
+namespace Pong
+{
+	// Streaming reducer: fixed bins over [lo, hi), linear or logarithmic,
+	// plus the count, sums and extremes. Nothing grows with the number of
+	// values added; values outside the range are counted in the first or
+	// last bin, while min and max stay exact.
+	struct Histogram
+	{
+		double lo;
+		double hi;
+		bool logarithmic;
+		double scale;
+		std::vector<unsigned long long> bins;
+		unsigned long long count;
+		double sum;
+		double sum2;
+		double min;
+		double max;
+
+		Histogram(double _lo, double _hi, unsigned int _bins, bool _logarithmic = false)
+			:
+			lo(_lo),
+			hi(_hi),
+			logarithmic(_logarithmic),
+			scale(_bins / (_logarithmic ? std::log(_hi / _lo) : _hi - _lo)),
+			bins(_bins, 0),
+			count(0),
+			sum(0),
+			sum2(0),
+			min(0),
+			max(0)
+		{
+		}
+		void add(double _x)
+		{
+			double t((logarithmic ? std::log(_x / lo) : _x - lo) * scale);
+			size_t bin(t > 0 ? std::min(bins.size() - 1, size_t(t)) : 0);
+			bins[bin]++;
+			if (!count || _x < min)min = _x;
+			if (!count || _x > max)max = _x;
+			++count;
+			sum += _x;
+			sum2 += _x * _x;
+		}
+		//_a must have the same bins
+		void merge(Histogram const& _a)
+		{
+			if (!_a.count)return;
+			for (size_t c0(0); c0 < bins.size(); ++c0)
+				bins[c0] += _a.bins[c0];
+			if (!count || _a.min < min)min = _a.min;
+			if (!count || _a.max > max)max = _a.max;
+			count += _a.count;
+			sum += _a.sum;
+			sum2 += _a.sum2;
+		}
+		//lower edge of bin _bin; fractional bins interpolate
+		double edge(double _bin)const
+		{
+			return logarithmic ? lo * std::exp(_bin / scale) : lo + _bin / scale;
+		}
+		double mean()const
+		{
+			return count ? sum / count : 0;
+		}
+		double deviation()const
+		{
+			if (!count)return 0;
+			double m(mean());
+			return std::sqrt(std::max(0.0, sum2 / count - m * m));
+		}
+		//interpolated within the bin holding rank _q * count, clamped to [min, max]
+		double quantile(double _q)const
+		{
+			if (!count)return 0;
+			double rank(_q * count);
+			unsigned long long seen(0);
+			for (size_t c0(0); c0 < bins.size(); ++c0)
+			{
+				if (bins[c0] && seen + bins[c0] >= rank)
+				{
+					double a(edge(c0 + (rank - seen) / bins[c0]));
+					return std::min(std::max(a, min), max);
+				}
+				seen += bins[c0];
+			}
+			return max;
+		}
+	};
+
+	// Plays every point of a grid over G, r0 and ballSpeed for a fixed number
+	// of frames. Grid points are mapped to the lanes of PhysicsBatch, lanes
+	// consecutive points per batch, and the batches are spread over all cores
+	// with WorkStealingPool. Each point gets its own reducers: seat losses,
+	// rally length in frames, bounces per rally and the hit offset ita (the
+	// offset from the paddle centre in half widths, -1 to 1). A lane is
+	// deterministic, so results do not depend on threads or lanes.
+	struct Sweep
+	{
+		struct Axis
+		{
+			double min;
+			double max;
+			unsigned int steps;
+
+			Axis(double _value = 0)
+				:
+				min(_value),
+				max(_value),
+				steps(1)
+			{
+			}
+			double value(unsigned int _step)const
+			{
+				return steps > 1 ? min + (max - min) * _step / (steps - 1) : min;
+			}
+		};
+		struct Settings
+		{
+			Axis G;
+			Axis r0;
+			Axis ballSpeed;
+			SeatKind seats[6];
+			unsigned long long frames;
+			unsigned int lanes;
+			unsigned int threads;
+			//steps a Physics next to every lane and counts diverging frames
+			bool verify;
+
+			Settings()
+				:
+				G(Defaults::G),
+				r0(Defaults::r0),
+				ballSpeed(Defaults::ballSpeed),
+				seats{ EasySeat, BrutalSeat, BrutalSeat, EasySeat, BrutalSeat, BrutalSeat },
+				frames(100000),
+				lanes(64),
+				threads(0),
+				verify(false)
+			{
+			}
+			unsigned long long size()const
+			{
+				return (unsigned long long)G.steps * r0.steps * ballSpeed.steps;
+			}
+			//ballSpeed varies fastest, then r0, then G
+			LaneTuning point(unsigned long long _index)const
+			{
+				unsigned int s((unsigned int)(_index % ballSpeed.steps));
+				_index /= ballSpeed.steps;
+				unsigned int r((unsigned int)(_index % r0.steps));
+				unsigned int g((unsigned int)(_index / r0.steps));
+				return LaneTuning(G.value(g), r0.value(r), ballSpeed.value(s));
+			}
+		};
+		struct Point
+		{
+			LaneTuning tuning;
+			unsigned long long frames;
+			unsigned long long points;
+			unsigned long long losts[6];
+			Histogram rally;
+			Histogram bounces;
+			Histogram ita;
+
+			Point()
+				:
+				tuning(),
+				frames(0),
+				points(0),
+				losts{ 0 },
+				rally(1, 1e6, 60, true),
+				bounces(0, 256, 256),
+				ita(-1, 1, 40)
+			{
+			}
+		};
+
+		Settings settings;
+		std::vector<Point> points;
+		unsigned long long steals;
+		std::atomic<unsigned long long> mismatches;
+
+		Sweep(Settings const& _settings)
+			:
+			settings(_settings),
+			points(_settings.size()),
+			steals(0),
+			mismatches(0)
+		{
+			for (unsigned long long c0(0); c0 < points.size(); ++c0)
+				points[c0].tuning = settings.point(c0);
+		}
+		void run()
+		{
+			WorkStealingPool pool(settings.threads);
+			unsigned int lanes(std::max(settings.lanes, 1u));
+			unsigned long long batches((points.size() + lanes - 1) / lanes);
+			pool.run(batches, [this, lanes](unsigned int, unsigned long long _batch)
+				{
+					unsigned long long first(_batch * lanes);
+					play(first, (unsigned int)std::min<unsigned long long>(lanes, points.size() - first));
+				});
+			steals = pool.steals;
+		}
+		//points [_first, _first + _n) as the lanes of one batch; lane c serves
+		//from seat (_first + c) % 6 first
+		void play(unsigned long long _first, unsigned int _n)
+		{
+			PhysicsBatch batch(_n, settings.seats);
+			std::vector<unsigned int> frames(_n, 0), bounces(_n, 0);
+			for (unsigned int c0(0); c0 < _n; ++c0)
+			{
+				batch.tune(c0, points[_first + c0].tuning);
+				batch.init(c0, (unsigned int)((_first + c0) % 6));
+				points[_first + c0].frames = settings.frames;
+			}
+			std::vector<Match> matches(settings.verify ? _n : 0);
+			std::vector<std::unique_ptr<Player>> seats;
+			for (unsigned int c0(0); c0 < matches.size(); ++c0)
+			{
+				matches[c0].physics.tune(points[_first + c0].tuning.tuning());
+				matches[c0].physics.lostPlayer = batch.lostPlayer[c0];
+				matches[c0].physics.init();
+				for (unsigned int c1(0); c1 < 6; ++c1)
+				{
+					seats.emplace_back(createPlayer(settings.seats[c1], &matches[c0].physics, c1));
+					matches[c0].players[c1] = seats.back().get();
+				}
+			}
+			unsigned long long diverged(0);
+			for (unsigned long long c0(0); c0 < settings.frames; ++c0)
+			{
+				batch.update();
+				for (unsigned int c1(0); c1 < _n; ++c1)
+				{
+					Point& point(points[_first + c1]);
+					++frames[c1];
+					//the first crossed edge is the bounce or the loss, as in update()
+					for (unsigned int c2(0); c2 < 6; ++c2)
+						if (batch.intersected[c2][c1])
+						{
+							if (!batch.ended[c1])
+							{
+								point.ita.add((batch.t2[c2][c1] - (batch.offsets[c2][c1] + 1) / 2) / playerWHalf);
+								++bounces[c1];
+							}
+							break;
+						}
+					if (batch.ended[c1])
+					{
+						point.points++;
+						point.losts[batch.lostPlayer[c1]]++;
+						point.rally.add(frames[c1]);
+						point.bounces.add(bounces[c1]);
+						frames[c1] = 0;
+						bounces[c1] = 0;
+						batch.ended[c1] = false;
+						batch.init(c1);
+					}
+				}
+				for (unsigned int c1(0); c1 < matches.size(); ++c1)
+				{
+					Physics& physics(matches[c1].physics);
+					matches[c1].step();
+					bool same(physics.r[0] == batch.rx[c1] && physics.r[1] == batch.ry[c1] &&
+						physics.v[0] == batch.vx[c1] && physics.v[1] == batch.vy[c1] &&
+						physics.lostPlayer == batch.lostPlayer[c1]);
+					for (unsigned int c2(0); c2 < 6; ++c2)
+						same = same && physics.offsets[c2] == batch.offsets[c2][c1];
+					diverged += !same;
+				}
+			}
+			mismatches += diverged;
+		}
+		// One row per grid point: the knobs, the totals, summary statistics of
+		// each reducer and then its bin counts, each bin column named after
+		// its lower edge (rally_1.26 counts rallies from 1.26 frames up to the
+		// next column's edge).
+		bool write(char const* _path)const
+		{
+			FILE* file(fopen(_path, "w"));
+			if (!file)return false;
+			Point const empty;
+			fprintf(file, "G,r0,ballSpeed,frames,points,framesPerPoint");
+			for (unsigned int c0(0); c0 < 6; ++c0)
+				fprintf(file, ",lost%u", c0);
+			fprintf(file, ",rallyMean,rallyP50,rallyP90,rallyP99,rallyMax"
+				",bouncesMean,bouncesP50,bouncesP90,bouncesMax"
+				",itaMean,itaDeviation,itaP10,itaP50,itaP90");
+			header(file, "rally", empty.rally);
+			header(file, "bounces", empty.bounces);
+			header(file, "ita", empty.ita);
+			fprintf(file, "\n");
+			for (Point const& a : points)
+			{
+				fprintf(file, "%.9g,%.9g,%.9g,%llu,%llu,%.6g", a.tuning.G, a.tuning.r0, a.tuning.ballSpeed,
+					a.frames, a.points, a.points ? double(a.frames) / a.points : 0.0);
+				for (unsigned int c0(0); c0 < 6; ++c0)
+					fprintf(file, ",%llu", a.losts[c0]);
+				fprintf(file, ",%.6g,%.6g,%.6g,%.6g,%.6g", a.rally.mean(), a.rally.quantile(0.5),
+					a.rally.quantile(0.9), a.rally.quantile(0.99), a.rally.max);
+				fprintf(file, ",%.6g,%.6g,%.6g,%.6g", a.bounces.mean(), a.bounces.quantile(0.5),
+					a.bounces.quantile(0.9), a.bounces.max);
+				fprintf(file, ",%.6g,%.6g,%.6g,%.6g,%.6g", a.ita.mean(), a.ita.deviation(),
+					a.ita.quantile(0.1), a.ita.quantile(0.5), a.ita.quantile(0.9));
+				for (Histogram const* histogram : { &a.rally, &a.bounces, &a.ita })
+					for (unsigned long long bin : histogram->bins)
+						fprintf(file, ",%llu", bin);
+				fprintf(file, "\n");
+			}
+			return !fclose(file);
+		}
+		static void header(FILE* _file, char const* _name, Histogram const& _histogram)
+		{
+			for (size_t c0(0); c0 < _histogram.bins.size(); ++c0)
+				fprintf(_file, ",%s_%.4g", _name, _histogram.edge(double(c0)));
+		}
+	};
+}
@@ -0,0 +1,429 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <HexPongCore/Physics.h>
+
+namespace Pong
+{
+	// Match telemetry: one event per paddle contact (bounce or loss) with
+	// the seat, the hit offset, v before and after, the rally length and the
+	// frame. The simulation thread only copies events into its own
+	// preallocated Ring; a drain thread empties the rings every 4 ms
+	// into column blocks and writes them compressed. A full ring drops the
+	// event and counts it rather than stall the simulation, so memory stays
+	// bounded however long the matches run.
+	//
+	// File layout:
+	//   "HXTM", u32 version
+	//   blocks   varint events (> 0), then per column varint bytes and the
+	//            column's bytes: match, frame (zigzag varint deltas), rally
+	//            (varint), seat | kind << 5 (u8), offset, vIn x/y, vOut x/y
+	//            (each double XORed with the previous one of its column and
+	//            stored as a byte of leading << 4 | trailing zero bytes plus
+	//            the bytes between)
+	//   end      varint 0, varint dropped
+	// Every block starts from zero, so blocks decode independently. Version
+	// 1 files, from the six seat arena, packed seat | kind << 3.
+	namespace Telemetry
+	{
+		constexpr char magic[4] = { 'H', 'X', 'T', 'M' };
+		constexpr unsigned int version = 2;
+		constexpr unsigned int columns = 9;
+		constexpr unsigned int blockEvents = 4096;
+
+		enum Kind
+		{
+			Bounce = 0,
+			Loss = 1,
+		};
+
+		struct Event
+		{
+			unsigned long long match;
+			unsigned long long frame;
+			unsigned int rally;
+			unsigned char seat;
+			unsigned char kind;
+			double offset;
+			double vIn[2];
+			double vOut[2];
+		};
+
+		// Single producer, single consumer.
+		struct Ring
+		{
+			static constexpr unsigned int capacity = 1 << 14;
+
+			std::unique_ptr<Event[]> events;
+			alignas(64) std::atomic<unsigned long long> head;
+			alignas(64) std::atomic<unsigned long long> tail;
+			//producer side: stamped into every event, and the events lost to a full ring
+			unsigned long long match;
+			std::atomic<unsigned long long> dropped;
+
+			Ring()
+				:
+				events(new Event[capacity]),
+				head(0),
+				tail(0),
+				match(0),
+				dropped(0)
+			{
+			}
+			void push(Event const& _event)
+			{
+				unsigned long long h(head.load(std::memory_order_relaxed));
+				if (h - tail.load(std::memory_order_acquire) == capacity)
+				{
+					dropped.fetch_add(1, std::memory_order_relaxed);
+					return;
+				}
+				events[h & (capacity - 1)] = _event;
+				head.store(h + 1, std::memory_order_release);
+			}
+			//the contacts of the update that ended frame _frame
+			void record(Physics const& _physics, unsigned long long _frame, unsigned long long _rally)
+			{
+				unsigned int n(_physics.contactCount);
+				if (!n)return;
+				if (n > Physics::maxContacts)
+				{
+					dropped.fetch_add(n - Physics::maxContacts, std::memory_order_relaxed);
+					n = Physics::maxContacts;
+				}
+				for (unsigned int c0(0); c0 < n; ++c0)
+				{
+					Physics::Contact const& a(_physics.contacts[c0]);
+					push(Event{ match, _frame, (unsigned int)_rally, (unsigned char)a.edge,
+						(unsigned char)(a.lost ? Loss : Bounce), a.offset,
+						{ a.vIn[0], a.vIn[1] }, { a.vOut[0], a.vOut[1] } });
+				}
+			}
+			//consumer side
+			unsigned int pop(Event* _events, unsigned int _max)
+			{
+				unsigned long long t(tail.load(std::memory_order_relaxed));
+				unsigned long long h(head.load(std::memory_order_acquire));
+				unsigned int n((unsigned int)(h - t < _max ? h - t : _max));
+				for (unsigned int c0(0); c0 < n; ++c0)
+					_events[c0] = events[(t + c0) & (capacity - 1)];
+				tail.store(t + n, std::memory_order_release);
+				return n;
+			}
+		};
+
+		// One block of events, column by column.
+		struct Block
+		{
+			std::vector<unsigned char> data[columns];
+			unsigned int events;
+			unsigned long long last[columns];
+
+			Block()
+				:
+				events(0),
+				last{ 0 }
+			{
+			}
+			void clear()
+			{
+				for (unsigned int c0(0); c0 < columns; ++c0)
+				{
+					data[c0].clear();
+					last[c0] = 0;
+				}
+				events = 0;
+			}
+			static void putVarint(std::vector<unsigned char>& _data, unsigned long long _a)
+			{
+				while (_a >= 0x80)
+				{
+					_data.push_back((unsigned char)(_a & 0x7f) | 0x80);
+					_a >>= 7;
+				}
+				_data.push_back((unsigned char)_a);
+			}
+			void putDelta(unsigned int _column, unsigned long long _a)
+			{
+				long long d((long long)(_a - last[_column]));
+				last[_column] = _a;
+				putVarint(data[_column], ((unsigned long long)d << 1) ^ (unsigned long long)(d >> 63));
+			}
+			void putDouble(unsigned int _column, double _a)
+			{
+				unsigned long long bits;
+				memcpy(&bits, &_a, sizeof(bits));
+				unsigned long long x(bits ^ last[_column]);
+				last[_column] = bits;
+				unsigned int lead(0), trail(0);
+				if (!x)lead = 8;
+				else
+				{
+					while (!(x >> (56 - 8 * lead) & 0xff))++lead;
+					while (!(x >> (8 * trail) & 0xff))++trail;
+				}
+				std::vector<unsigned char>& d(data[_column]);
+				d.push_back((unsigned char)(lead << 4 | trail));
+				for (unsigned int c0(trail); c0 < 8 - lead; ++c0)
+					d.push_back((unsigned char)(x >> (8 * c0)));
+			}
+			void add(Event const& _event)
+			{
+				putDelta(0, _event.match);
+				putDelta(1, _event.frame);
+				putVarint(data[2], _event.rally);
+				data[3].push_back((unsigned char)(_event.seat | _event.kind << 5));
+				putDouble(4, _event.offset);
+				putDouble(5, _event.vIn[0]);
+				putDouble(6, _event.vIn[1]);
+				putDouble(7, _event.vOut[0]);
+				putDouble(8, _event.vOut[1]);
+				++events;
+			}
+		};
+
+		struct Log
+		{
+			FILE* file;
+			std::mutex mutex;
+			std::vector<std::unique_ptr<Ring>> rings;
+			std::thread thread;
+			std::atomic<bool> stopping;
+			Block block;
+			std::vector<unsigned char> buffer;
+			unsigned long long events;
+			unsigned long long bytes;
+			unsigned long long dropped;
+			bool failed;
+
+			Log()
+				:
+				file(nullptr),
+				mutex(),
+				rings(),
+				thread(),
+				stopping(false),
+				block(),
+				buffer(),
+				events(0),
+				bytes(0),
+				dropped(0),
+				failed(false)
+			{
+			}
+			Log(Log const&) = delete;
+			~Log()
+			{
+				close();
+			}
+			bool open(char const* _path)
+			{
+				file = fopen(_path, "wb");
+				if (!file)return false;
+				fwrite(magic, 1, 4, file);
+				fwrite(&version, sizeof(version), 1, file);
+				bytes = 8;
+				stopping = false;
+				thread = std::thread([this] {work(); });
+				return true;
+			}
+			//a ring for one producing thread; it lives as long as the Log
+			Ring* add()
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				rings.emplace_back(new Ring);
+				return rings.back().get();
+			}
+			//drains what is left and finishes the file; the producers must be done
+			void close()
+			{
+				if (!thread.joinable())return;
+				stopping = true;
+				thread.join();
+				drain();
+				flush();
+				for (std::unique_ptr<Ring> const& ring : rings)
+					dropped += ring->dropped;
+				buffer.clear();
+				Block::putVarint(buffer, 0);
+				Block::putVarint(buffer, dropped);
+				write();
+				failed = fclose(file) || failed;
+				file = nullptr;
+			}
+			void work()
+			{
+				//a ring holds ~60 ms of the busiest single match, so one pass
+				//per 4 ms keeps up without a core spinning on it
+				while (!stopping)
+				{
+					drain();
+					std::this_thread::sleep_for(std::chrono::milliseconds(4));
+				}
+			}
+			//moves every ring's events into blocks
+			void drain()
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				Event a[256];
+				for (std::unique_ptr<Ring> const& ring : rings)
+					while (unsigned int n = ring->pop(a, 256))
+					{
+						for (unsigned int c0(0); c0 < n; ++c0)
+						{
+							block.add(a[c0]);
+							if (block.events == blockEvents)flush();
+						}
+					}
+			}
+			void flush()
+			{
+				if (!block.events)return;
+				buffer.clear();
+				Block::putVarint(buffer, block.events);
+				for (unsigned int c0(0); c0 < columns; ++c0)
+				{
+					Block::putVarint(buffer, block.data[c0].size());
+					buffer.insert(buffer.end(), block.data[c0].begin(), block.data[c0].end());
+				}
+				events += block.events;
+				block.clear();
+				write();
+			}
+			void write()
+			{
+				failed = fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size() || failed;
+				bytes += buffer.size();
+			}
+			//bytes per event as plain fixed-size records
+			static constexpr unsigned int raw = 8 + 8 + 4 + 1 + 1 + 5 * 8;
+		};
+
+		struct Reader
+		{
+			FILE* file;
+			unsigned int version;
+			std::vector<unsigned char> data[columns];
+			size_t at[columns];
+			unsigned long long last[columns];
+			unsigned int left;
+			unsigned long long dropped;
+			bool ended;
+
+			Reader()
+				:
+				file(nullptr),
+				version(0),
+				at{ 0 },
+				last{ 0 },
+				left(0),
+				dropped(0),
+				ended(false)
+			{
+			}
+			Reader(Reader const&) = delete;
+			~Reader()
+			{
+				if (file)fclose(file);
+			}
+			bool open(char const* _path)
+			{
+				file = fopen(_path, "rb");
+				if (!file)return false;
+				char a[4];
+				return fread(a, 1, 4, file) == 4 && !memcmp(a, magic, 4) &&
+					fread(&version, sizeof(version), 1, file) == 1 && version && version <= Telemetry::version;
+			}
+			//false at the end of the file (ended) or on a damaged one
+			bool next(Event& _event)
+			{
+				if (!left && !block())return false;
+				--left;
+				unsigned long long rally(0), seat(0);
+				if (!getDelta(0, _event.match) || !getDelta(1, _event.frame) ||
+					!getVarint(data[2], at[2], rally) || at[3] >= data[3].size())return false;
+				seat = data[3][at[3]++];
+				_event.rally = (unsigned int)rally;
+				unsigned int shift(version >= 2 ? 5 : 3);
+				_event.seat = (unsigned char)(seat & ((1u << shift) - 1));
+				_event.kind = (unsigned char)(seat >> shift);
+				return getDouble(4, _event.offset) && getDouble(5, _event.vIn[0]) && getDouble(6, _event.vIn[1]) &&
+					getDouble(7, _event.vOut[0]) && getDouble(8, _event.vOut[1]);
+			}
+			bool block()
+			{
+				if (ended)return false;
+				unsigned long long n;
+				if (!getVarint(n))return false;
+				if (!n)
+				{
+					ended = getVarint(dropped);
+					return false;
+				}
+				for (unsigned int c0(0); c0 < columns; ++c0)
+				{
+					unsigned long long size;
+					if (!getVarint(size))return false;
+					data[c0].resize(size);
+					if (size && fread(data[c0].data(), 1, size, file) != size)return false;
+					at[c0] = 0;
+					last[c0] = 0;
+				}
+				left = (unsigned int)n;
+				return true;
+			}
+			bool getVarint(unsigned long long& _a)
+			{
+				_a = 0;
+				for (unsigned int c0(0); c0 < 64; c0 += 7)
+				{
+					int a(fgetc(file));
+					if (a == EOF)return false;
+					_a |= (unsigned long long)(a & 0x7f) << c0;
+					if (!(a & 0x80))return true;
+				}
+				return false;
+			}
+			static bool getVarint(std::vector<unsigned char> const& _data, size_t& _at, unsigned long long& _a)
+			{
+				_a = 0;
+				for (unsigned int c0(0); c0 < 64 && _at < _data.size(); c0 += 7)
+				{
+					unsigned char a(_data[_at++]);
+					_a |= (unsigned long long)(a & 0x7f) << c0;
+					if (!(a & 0x80))return true;
+				}
+				return false;
+			}
+			bool getDelta(unsigned int _column, unsigned long long& _a)
+			{
+				unsigned long long z;
+				if (!getVarint(data[_column], at[_column], z))return false;
+				last[_column] += (z >> 1) ^ (0 - (z & 1));
+				_a = last[_column];
+				return true;
+			}
+			bool getDouble(unsigned int _column, double& _a)
+			{
+				std::vector<unsigned char> const& d(data[_column]);
+				size_t& p(at[_column]);
+				if (p >= d.size())return false;
+				unsigned int lead(d[p] >> 4), trail(d[p] & 15);
+				++p;
+				if (lead > 8 || trail + lead > 8 || p + 8 - lead - trail > d.size())return false;
+				unsigned long long x(0);
+				for (unsigned int c0(trail); c0 < 8 - lead; ++c0)
+					x |= (unsigned long long)d[p++] << (8 * c0);
+				last[_column] ^= x;
+				memcpy(&_a, &last[_column], sizeof(_a));
+				return true;
+			}
+		};
+	}
+}
@@ -0,0 +1,224 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <HexPongCore/Match.h>
+#include <HexPongCore/WorkStealing.h>
+
+namespace Pong
+{
+	using PlayerFactory = std::function<Player* (Physics*, unsigned int)>;
+
+	struct Entrant
+	{
+		std::string name;
+		PlayerFactory factory;
+	};
+
+	// Plays matches between entrants over every seating order of the arena's
+	// seats (six by default). Match m uses permutation m % sides! and its own
+	// RNG stream derived from (seed, m), so results do not depend on which
+	// worker ran which match or on the thread count. Past 20 seats sides!
+	// overflows and match m gets a random permutation seeded with m instead.
+	struct Tournament
+	{
+		struct Settings
+		{
+			unsigned long long matches;
+			unsigned int points;
+			unsigned long long frameLimit;
+			unsigned long long seed;
+			unsigned int threads;
+			unsigned int batch;
+			double jitter;
+			//seats, and sides of the arena; callers check validSides() first
+			unsigned int sides;
+			Tuning tuning;
+			//events of every match, tagged with the match number
+			Telemetry::Log* telemetry;
+
+			Settings()
+				:
+				matches(720),
+				points(20),
+				frameLimit(1000000),
+				seed(20210709),
+				threads(0),
+				batch(8),
+				jitter(0.05),
+				sides(Hexagon::sides),
+				tuning(),
+				telemetry(nullptr)
+			{
+			}
+		};
+		// Per-worker totals, padded to a cache line so workers never share
+		// one; merged once after the pool has finished.
+		struct alignas(64) Tally
+		{
+			unsigned long long matches;
+			unsigned long long frames;
+			unsigned long long points;
+			unsigned long long seatLosts[maxSides];
+			unsigned int sides;
+			std::vector<unsigned long long> losts;
+			std::vector<unsigned long long> played;
+
+			Tally(unsigned int _entrants = 0, unsigned int _sides = Hexagon::sides)
+				:
+				matches(0),
+				frames(0),
+				points(0),
+				seatLosts{ 0 },
+				sides(_sides),
+				losts(_entrants, 0),
+				played(_entrants, 0)
+			{
+			}
+			void merge(Tally const& _a)
+			{
+				matches += _a.matches;
+				frames += _a.frames;
+				points += _a.points;
+				for (unsigned int c0(0); c0 < sides; ++c0)
+					seatLosts[c0] += _a.seatLosts[c0];
+				for (unsigned int c0(0); c0 < losts.size(); ++c0)
+				{
+					losts[c0] += _a.losts[c0];
+					played[c0] += _a.played[c0];
+				}
+			}
+			//losses per point played, scaled so that 1 is an average seat
+			double rating(unsigned int _entrant)const
+			{
+				return played[_entrant] ? double(sides) * losts[_entrant] / played[_entrant] : 0;
+			}
+		};
+
+		std::vector<Entrant> roster;
+		unsigned long long steals;
+
+		Tournament(std::vector<Entrant> const& _roster)
+			:
+			roster(_roster),
+			steals(0)
+		{
+		}
+		static unsigned long long mix(unsigned long long _a)
+		{
+			_a += 0x9e3779b97f4a7c15ull;
+			_a = (_a ^ (_a >> 30)) * 0xbf58476d1ce4e5b9ull;
+			_a = (_a ^ (_a >> 27)) * 0x94d049bb133111ebull;
+			return _a ^ (_a >> 31);
+		}
+		//_seats[c] = index of the roster entry at seat c of _sides for match _match
+		void seating(unsigned long long _match, unsigned int* _seats, unsigned int _sides = Hexagon::sides)const
+		{
+			unsigned int order[maxSides];
+			for (unsigned int c0(0); c0 < _sides; ++c0)
+				order[c0] = c0;
+			if (_sides > 20)
+			{
+				std::mt19937_64 rng(mix(_match));
+				for (unsigned int c0(_sides - 1); c0 > 0; --c0)
+					std::swap(order[c0], order[rng() % (c0 + 1)]);
+				for (unsigned int c0(0); c0 < _sides; ++c0)
+					_seats[c0] = order[c0] % roster.size();
+				return;
+			}
+			unsigned long long permutations(1);
+			for (unsigned int c0(2); c0 <= _sides; ++c0)permutations *= c0;
+			unsigned long long k(_match % permutations);
+			for (unsigned int c0(0); c0 < _sides; ++c0)
+			{
+				unsigned long long f(1);
+				for (unsigned int c1(2); c1 < _sides - c0; ++c1)f *= c1;
+				unsigned int pick((unsigned int)(k / f));
+				k %= f;
+				_seats[c0] = order[pick] % roster.size();
+				for (unsigned int c1(pick); c1 + 1 < _sides - c0; ++c1)
+					order[c1] = order[c1 + 1];
+			}
+		}
+		//_record: the match is also written as a replay there, its serves as
+		//keyframes and each seat's entrant by the first letter of its name;
+		//false if that file could not be written
+		bool play(unsigned long long _match, Settings const& _settings, Tally& _tally, Telemetry::Ring* _telemetry = nullptr,
+			char const* _record = nullptr)const
+		{
+			std::mt19937_64 rng(mix(_settings.seed ^ mix(_match)));
+			std::uniform_real_distribution<double> shift(-_settings.jitter, _settings.jitter);
+			unsigned int sides(_settings.sides);
+			unsigned int seats[maxSides];
+			seating(_match, seats, sides);
+
+			Match match(sides);
+			std::unique_ptr<Player> players[maxSides];
+			for (unsigned int c0(0); c0 < sides; ++c0)
+			{
+				players[c0].reset(roster[seats[c0]].factory(&match.physics, c0));
+				match.players[c0] = players[c0].get();
+			}
+			if (_telemetry)
+			{
+				_telemetry->match = _match;
+				match.telemetry = _telemetry;
+			}
+			match.physics.tune(_settings.tuning);
+			match.physics.lostPlayer = rng() % sides;
+			match.physics.init();
+			match.physics.r += match.physics.arena.tangent(match.physics.lostPlayer) * shift(rng);
+			Replay::Writer recorder;
+			if (_record)
+			{
+				char names[maxSides + 1]{ 0 };
+				for (unsigned int c0(0); c0 < sides; ++c0)
+					names[c0] = roster[seats[c0]].name[0];
+				if (!recorder.open(_record, match.physics, names))return false;
+				match.recorder = &recorder;
+			}
+			while (match.points < _settings.points && match.frames < _settings.frameLimit)
+				if (match.step())
+				{
+					match.physics.r += match.physics.arena.tangent(match.physics.lostPlayer) * shift(rng);
+					if (match.recorder)recorder.keyframe(match.physics);
+				}
+
+			_tally.matches++;
+			_tally.frames += match.frames;
+			_tally.points += match.points;
+			for (unsigned int c0(0); c0 < sides; ++c0)
+			{
+				_tally.seatLosts[c0] += match.losts[c0];
+				_tally.losts[seats[c0]] += match.losts[c0];
+				_tally.played[seats[c0]] += match.points;
+			}
+			return recorder.close(match.physics);
+		}
+		Tally run(Settings const& _settings)
+		{
+			WorkStealingPool pool(_settings.threads);
+			std::vector<Tally> tallies(pool.threads, Tally(unsigned(roster.size()), _settings.sides));
+			std::vector<Telemetry::Ring*> rings(pool.threads, nullptr);
+			if (_settings.telemetry)
+				for (Telemetry::Ring*& ring : rings)
+					ring = _settings.telemetry->add();
+			unsigned int batch(std::max(_settings.batch, 1u));
+			unsigned long long batches((_settings.matches + batch - 1) / batch);
+			pool.run(batches, [&](unsigned int _worker, unsigned long long _batch)
+				{
+					unsigned long long end(std::min((_batch + 1) * batch, _settings.matches));
+					for (unsigned long long c0(_batch * batch); c0 < end; ++c0)
+						play(c0, _settings, tallies[_worker], rings[_worker]);
+				});
+			steals = pool.steals;
+			Tally total(unsigned(roster.size()), _settings.sides);
+			for (Tally const& tally : tallies)
+				total.merge(tally);
+			return total;
+		}
+	};
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Pong
+{
+	// Fixed set of workers, each owning a deque of task indices. A worker
+	// takes from the back of its own deque and, once that is empty, steals
+	// from the front of the others, so uneven tasks (long rallies) balance
+	// out without a shared queue. Locks are per deque and only contended
+	// while stealing.
+	struct WorkStealingPool
+	{
+		struct alignas(64) Queue
+		{
+			std::mutex mutex;
+			std::deque<unsigned long long> tasks;
+		};
+
+		unsigned int threads;
+		std::unique_ptr<Queue[]> queues;
+		std::atomic<unsigned long long> steals;
+
+		WorkStealingPool(unsigned int _threads = 0)
+			:
+			threads(_threads ? _threads : std::thread::hardware_concurrency()),
+			queues(),
+			steals(0)
+		{
+			if (!threads)threads = 1;
+			queues.reset(new Queue[threads]);
+		}
+		// Calls _task(worker, index) for every index in [0, _count); each
+		// worker starts with a contiguous block of indices.
+		template<class F>void run(unsigned long long _count, F&& _task)
+		{
+			for (unsigned int c0(0); c0 < threads; ++c0)
+			{
+				unsigned long long begin(_count * c0 / threads), end(_count * (c0 + 1) / threads);
+				for (unsigned long long c1(begin); c1 < end; ++c1)
+					queues[c0].tasks.push_back(c1);
+			}
+			std::vector<std::thread> workers;
+			for (unsigned int c0(1); c0 < threads; ++c0)
+				workers.emplace_back([this, c0, &_task] {work(c0, _task); });
+			work(0, _task);
+			for (std::thread& worker : workers)
+				worker.join();
+		}
+		bool pop(unsigned int _worker, unsigned long long& _index)
+		{
+			Queue& own(queues[_worker]);
+			{
+				std::lock_guard<std::mutex> lock(own.mutex);
+				if (own.tasks.size())
+				{
+					_index = own.tasks.back();
+					own.tasks.pop_back();
+					return true;
+				}
+			}
+			for (unsigned int c0(1); c0 < threads; ++c0)
+			{
+				Queue& victim(queues[(_worker + c0) % threads]);
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (victim.tasks.size())
+				{
+					_index = victim.tasks.front();
+					victim.tasks.pop_front();
+					steals.fetch_add(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+			return false;
+		}
+		template<class F>void work(unsigned int _worker, F& _task)
+		{
+			unsigned long long index;
+			while (pop(_worker, index))
+				_task(_worker, index);
+		}
+	};
+}
@@ -1,60 +1,414 @@
-#include <_Math.h>
+#include <cstdio>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include <HexPongCore/AI.h>
+#include <HexPongCore/Physics.h>
+#include <HexPongCore/Tournament.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
 
-struct LineSegment
+// Benchmark suite for the simulation: edge intersection, the physics step,
+// AI decisions and whole matches. Inputs come from fixed seeds, so numbers
+// from two builds measure the same work. Every benchmark is run repeats
+// times after a warm-up and the fastest run is kept. The intersection
+// kernels are first checked bit for bit against LineSegment::intersect; the
+// exit code is 1 on any mismatch.
+//
+//   Intersection [-q] [-j] [-b name]
+//     -q  quick: an eighth of the work (smoke tests)
+//     -j  JSON on stdout instead of the table
+//     -b  only benchmarks whose name contains name
+
+using namespace Pong;
+using LineSegment = Physics::LineSegment;
+
+bool same(LineSegment::Intersection const& a, LineSegment::Intersection const& b)
 {
-	using vec2 = Math::vec2<double>;
-	struct Intersection
-	{
-		using vec2 = Math::vec2<double>;
+	return a.intersected == b.intersected &&
+		!memcmp(&a.t1, &b.t1, sizeof(double)) && !memcmp(&a.t2, &b.t2, sizeof(double)) &&
+		!memcmp(a.point.data, b.point.data, sizeof(a.point.data));
+}
 
-		bool intersected;
-		double t1, t2;
-		vec2 point;
-		Intersection()
-			:
-			intersected(false),
-			t1(0),
-			t2(0),
-			point{ 0 }
-		{
+//time stamp counter ticks, 0 where there is none
+inline unsigned long long cycles()
+{
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
 
-		}
-	};
+struct Result
+{
+	std::string name;
+	unsigned long long ops;
+	//physics steps done by those ops, 0 if they are not steps
+	unsigned long long steps;
+	double seconds;
+	double cycles;
+};
 
-	vec2 A, B;
+struct Suite
+{
+	unsigned int repeats;
+	char const* filter;
+	std::vector<Result> results;
 
-	Intersection intersect(LineSegment b)
+	Suite()
+		:
+		repeats(5),
+		filter(nullptr),
+		results()
 	{
-		Intersection r;
-		//todo: pre-test
-		double l1((B - A).length()), l2((b.B - b.A).length());
-		vec2 k1((B - A) / l1), k2((b.B - b.A) / l2);
-		vec2 d(A - b.A);
-		double s(k2[0] * k1[1] - k1[0] * k2[1]);
-		if (s == 0)
+	}
+	// _f() does _ops operations (and _steps physics steps) per call
+	template<class F>void run(char const* _name, unsigned long long _ops, unsigned long long _steps, F&& _f)
+	{
+		if (filter && !strstr(_name, filter))return;
+		_f();
+		Result best{ _name, _ops, _steps, 1e300, 0 };
+		for (unsigned int c0(0); c0 < repeats; ++c0)
 		{
-			r.intersected = false;
-			return r;
+			auto t0(std::chrono::steady_clock::now());
+			unsigned long long k0(cycles());
+			_f();
+			unsigned long long k1(cycles());
+			double seconds(std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+			if (seconds < best.seconds)
+			{
+				best.seconds = seconds;
+				best.cycles = double(k1 - k0);
+			}
+		}
+		results.push_back(best);
+	}
+	void print()const
+	{
+		printf("%-30s %10s %14s %14s %10s\n", "Benchmark", "ns/op", "op/s", "steps/s", "cycles/op");
+		for (Result const& a : results)
+		{
+			printf("%-30s %10.2lf %14.0lf ", a.name.c_str(), a.seconds / a.ops * 1e9, a.ops / a.seconds);
+			if (a.steps)printf("%14.0lf ", a.steps / a.seconds);
+			else printf("%14s ", "-");
+			printf("%10.1lf\n", a.cycles / a.ops);
 		}
-		r.t1 = (d[0] * k2[1] - k2[0] * d[1]) / s;
-		r.t2 = (d[0] * k1[1] - k1[0] * d[1]) / s;
-		r.point = (A + k1 * r.t1 + b.A + k2 * r.t2) / 2;
-		if (r.t1 < 0 || r.t1 > l1 || r.t2 < 0 || r.t2 > l2)
-			r.intersected = false;
-		else
-			r.intersected = true;
-		return r;
+	}
+	void json(unsigned int _mismatches)const
+	{
+		printf("{\n\t\"simd\": \"%s\",\n\t\"mismatches\": %u,\n\t\"results\": [", Simd::bestName, _mismatches);
+		for (size_t c0(0); c0 < results.size(); ++c0)
+		{
+			Result const& a(results[c0]);
+			printf("%s\n\t\t{ \"name\": \"%s\", \"ops\": %llu, \"seconds\": %.9lf, \"ns_per_op\": %.4lf, "
+				"\"ops_per_s\": %.1lf, \"steps_per_s\": %.1lf, \"cycles_per_op\": %.2lf }",
+				c0 ? "," : "", a.name.c_str(), a.ops, a.seconds, a.seconds / a.ops * 1e9,
+				a.ops / a.seconds, a.steps / a.seconds, a.cycles / a.ops);
+		}
+		printf("\n\t]\n}\n");
 	}
 };
 
-int main()
+unsigned int checkEdges(std::vector<Math::vec2<double>> const& A, std::vector<Math::vec2<double>> const& B,
+	Arena const& arena, LineSegment const* lines, EdgeTable const& edges, unsigned int& hits)
+{
+	using namespace Math;
+	unsigned int count(unsigned(A.size())), mismatches(0);
+	LineSegment::Intersection its[maxSides], ref[maxSides];
+	for (unsigned int c0(0); c0 < count; ++c0)
+	{
+		LineSegment dr(A[c0], B[c0]);
+		for (unsigned int c1(0); c1 < arena.sides; ++c1)
+			ref[c1] = dr.intersect(lines[c1]);
+		unsigned int mask(edges.intersect(A[c0], B[c0], its));
+		for (unsigned int c1(0); c1 < arena.sides; ++c1)
+		{
+			mismatches += !same(its[c1], ref[c1]) || (mask >> c1 & 1) != ref[c1].intersected;
+			hits += ref[c1].intersected;
+		}
+		edges.intersect<LineSegment::Intersection, Simd::Scalar>(A[c0], B[c0], its);
+		for (unsigned int c1(0); c1 < arena.sides; ++c1)
+			mismatches += !same(its[c1], ref[c1]);
+		//the per-edge kernel, and a broad phase that never drops a crossing
+		EdgeTable::Ray ray(EdgeTable::ray(A[c0], B[c0]));
+		unsigned int candidates(arena.candidates(A[c0], B[c0]));
+		for (unsigned int c1(0); c1 < arena.sides; ++c1)
+		{
+			edges.intersect(ray, c1, its[c1]);
+			mismatches += !same(its[c1], ref[c1]);
+			mismatches += ref[c1].intersected && !(candidates >> c1 & 1);
+		}
+	}
+	return mismatches;
+}
+
+int main(int argc, char** argv)
 {
 	using namespace Math;
 
-	LineSegment AB{ {0,0},{1,1} };
-	LineSegment CD{ {0,1},{2,0} };
+	Suite suite;
+	bool quick(false), json(false);
+	for (int c0(1); c0 < argc; ++c0)
+	{
+		if (!strcmp(argv[c0], "-q"))quick = true;
+		else if (!strcmp(argv[c0], "-j"))json = true;
+		else if (!strcmp(argv[c0], "-b") && c0 + 1 < argc)suite.filter = argv[++c0];
+		else
+		{
+			printf("Usage: Intersection [-q] [-j] [-b name]\n");
+			return 1;
+		}
+	}
+	unsigned int scale(quick ? 8 : 1);
+	if (quick)suite.repeats = 2;
+
+	Arena hexagon;
+	LineSegment lines[6];
+	Physics::hexagon(lines);
+	EdgeTable edges(lines);
+
+	constexpr unsigned int count = 1 << 16;
+	unsigned int rounds(64 / scale);
+	std::mt19937_64 rng(20210709);
+	std::uniform_real_distribution<double> pos(-1.1, 1.1), step(-0.05, 0.05);
+	std::vector<vec2<double>> A(count), B(count);
+	std::vector<double> rx(count), ry(count), r1x(count), r1y(count);
+	for (unsigned int c0(0); c0 < count; ++c0)
+	{
+		A[c0] = { pos(rng), pos(rng) };
+		B[c0] = A[c0] + vec2<double>{ step(rng), step(rng) };
+		rx[c0] = A[c0][0];
+		ry[c0] = A[c0][1];
+		r1x[c0] = B[c0][0];
+		r1y[c0] = B[c0][1];
+	}
+	//arbitrary segment pairs, not just short steps against the border
+	std::vector<LineSegment> P(count), Q(count);
+	for (unsigned int c0(0); c0 < count; ++c0)
+	{
+		P[c0] = LineSegment(vec2<double>{ pos(rng), pos(rng) }, vec2<double>{ pos(rng), pos(rng) });
+		Q[c0] = LineSegment(vec2<double>{ pos(rng), pos(rng) }, vec2<double>{ pos(rng), pos(rng) });
+	}
+
+	unsigned int hits(0);
+	unsigned int mismatches(checkEdges(A, B, hexagon, lines, edges, hits));
+	//the same over other arenas, the samples scaled to their size
+	unsigned int polygonHits(0);
+	for (unsigned int sides : { 3u, 12u, 32u })
+	{
+		Arena arena(sides);
+		LineSegment polygon[maxSides];
+		Physics::polygon(arena, polygon);
+		std::vector<vec2<double>> a(count / 8), b(count / 8);
+		for (unsigned int c0(0); c0 < a.size(); ++c0)
+		{
+			a[c0] = A[c0] * arena.R;
+			b[c0] = a[c0] + (B[c0] - A[c0]);
+		}
+		mismatches += checkEdges(a, b, arena, polygon, EdgeTable(polygon, sides), polygonHits);
+	}
+
+	std::vector<double> t1[6], t2[6], px[6], py[6];
+	std::vector<unsigned char> hit[6];
+	double* t1s[6], * t2s[6], * pxs[6], * pys[6];
+	unsigned char* hitss[6];
+	for (unsigned int c1(0); c1 < 6; ++c1)
+	{
+		t1[c1].resize(count); t2[c1].resize(count);
+		px[c1].resize(count); py[c1].resize(count);
+		hit[c1].resize(count);
+		t1s[c1] = t1[c1].data(); t2s[c1] = t2[c1].data();
+		pxs[c1] = px[c1].data(); pys[c1] = py[c1].data();
+		hitss[c1] = hit[c1].data();
+	}
+	edges.intersect(count, rx.data(), ry.data(), r1x.data(), r1y.data(), t1s, t2s, pxs, pys, hitss);
+	for (unsigned int c0(0); c0 < count; ++c0)
+	{
+		LineSegment dr(A[c0], B[c0]);
+		for (unsigned int c1(0); c1 < 6; ++c1)
+		{
+			LineSegment::Intersection it;
+			it.intersected = hit[c1][c0];
+			it.t1 = t1[c1][c0];
+			it.t2 = t2[c1][c0];
+			it.point = vec2<double>{ px[c1][c0], py[c1][c0] };
+			mismatches += !same(it, dr.intersect(lines[c1]));
+		}
+	}
+	if (!json)printf("%u segments, %u hits (%u more in 3-, 12- and 32-gons), %u mismatches against LineSegment::intersect, %s kernels\n",
+		count, hits, polygonHits, mismatches, Simd::bestName);
+
+	volatile unsigned int sink(0);
+	LineSegment::Intersection its[6], ref[6];
+	unsigned long long balls((unsigned long long)count * rounds);
+	suite.run("LineSegment::intersect", balls, 0, [&]
+		{
+			for (unsigned int c1(0); c1 < rounds; ++c1)
+				for (unsigned int c0(0); c0 < count; ++c0)
+					sink = sink + P[c0].intersect(Q[c0]).intersected;
+		});
+	suite.run("6x LineSegment::intersect", balls, 0, [&]
+		{
+			for (unsigned int c1(0); c1 < rounds; ++c1)
+				for (unsigned int c0(0); c0 < count; ++c0)
+				{
+					LineSegment dr(A[c0], B[c0]);
+					for (unsigned int c2(0); c2 < 6; ++c2)
+						ref[c2] = dr.intersect(lines[c2]);
+					sink = sink + ref[c0 % 6].intersected;
+				}
+		});
+	suite.run("EdgeTable scalar", balls, 0, [&]
+		{
+			for (unsigned int c1(0); c1 < rounds; ++c1)
+				for (unsigned int c0(0); c0 < count; ++c0)
+				{
+					edges.intersect<LineSegment::Intersection, Simd::Scalar>(A[c0], B[c0], its);
+					sink = sink + its[c0 % 6].intersected;
+				}
+		});
+	suite.run("EdgeTable single ball", balls, 0, [&]
+		{
+			for (unsigned int c1(0); c1 < rounds; ++c1)
+				for (unsigned int c0(0); c0 < count; ++c0)
+				{
+					edges.intersect(A[c0], B[c0], its);
+					sink = sink + its[c0 % 6].intersected;
+				}
+		});
+	//what Physics::integrate does: the candidates only, the rest cleared; about
+	//half of these samples end outside the inscribed circle, far more than in play
+	suite.run("EdgeTable broad phase", balls, 0, [&]
+		{
+			for (unsigned int c1(0); c1 < rounds; ++c1)
+				for (unsigned int c0(0); c0 < count; ++c0)
+				{
+					unsigned int candidates(hexagon.candidates(A[c0], B[c0]));
+					EdgeTable::Ray ray(EdgeTable::ray(A[c0], B[c0]));
+					for (unsigned int c2(0); c2 < 6; ++c2)
+						if (candidates >> c2 & 1)edges.intersect(ray, c2, its[c2]);
+						else its[c2].intersected = false;
+					sink = sink + its[c0 % 6].intersected;
+				}
+		});
+	suite.run("EdgeTable across balls", balls, 0, [&]
+		{
+			for (unsigned int c1(0); c1 < rounds; ++c1)
+			{
+				edges.intersect(count, rx.data(), ry.data(), r1x.data(), r1y.data(), t1s, t2s, pxs, pys, hitss);
+				sink = sink + hit[0][0];
+			}
+		});
+
+	//the physics step with the seats idle, with BrutalAIs and with EasyAIs
+	unsigned long long steps(1000000 / scale);
+	//then with the knobs read from a runtime Tuning instead of Defaults, and
+	//in larger arenas, where the collision stays a few edge tests and only
+	//the seats add up
+	Tuning tuning;
+	tuning.G = 0.31;
+	for (char const* roster : { "SSSSSS", "BBBBBB", "EEEEEE", "BBBBBB tuned", "12 S", "32 S", "32 B" })
+	{
+		std::string name(std::string("Physics::update ") + roster);
+		bool tuned(strstr(roster, " tuned") != nullptr);
+		unsigned int sides(Hexagon::sides);
+		char seat(roster[0]);
+		if (roster[0] >= '0' && roster[0] <= '9')
+		{
+			sides = unsigned(atoi(roster));
+			seat = strchr(roster, ' ')[1];
+		}
+		suite.run(name.c_str(), steps, steps, [&]
+			{
+				Match match(sides);
+				if (tuned)match.physics.tune(tuning);
+				std::unique_ptr<Player> players[maxSides];
+				for (unsigned int c0(0); c0 < sides; ++c0)
+				{
+					players[c0].reset(createPlayer(SeatKind(sides == Hexagon::sides ? roster[c0] : seat), &match.physics, c0));
+					match.players[c0] = players[c0].get();
+				}
+				match.run(steps);
+				sink = sink + match.losts[0];
+			});
+	}
+
+	//decisions from states sampled along a BBBBBB match, each restored first
+	std::vector<PhysicsState> states;
+	{
+		Match match;
+		BrutalAI brutal[6]{ {&match.physics,0},{&match.physics,1},{&match.physics,2},
+			{&match.physics,3},{&match.physics,4},{&match.physics,5} };
+		for (unsigned int c0(0); c0 < 6; ++c0)
+			match.players[c0] = brutal + c0;
+		for (unsigned int c0(0); c0 < 4096; ++c0)
+		{
+			match.run(97);
+			states.push_back(match.physics.state());
+		}
+	}
+	unsigned long long decisions((unsigned long long)states.size() * 6 * (64 / scale));
+	Physics physics;
+	auto decide = [&](Player** _players)
+	{
+		for (unsigned int c2(0); c2 < 64 / scale; ++c2)
+			for (PhysicsState const& state : states)
+			{
+				physics.restore(state);
+				physics.integrate();
+				for (unsigned int c0(0); c0 < 6; ++c0)
+					sink = sink + _players[c0]->update();
+			}
+	};
+	Player stops[6];
+	EasyAI easy[6]{ {&physics,0},{&physics,1},{&physics,2},{&physics,3},{&physics,4},{&physics,5} };
+	BrutalAI brutal[6]{ {&physics,0},{&physics,1},{&physics,2},{&physics,3},{&physics,4},{&physics,5} };
+	Player* stopSeats[6], * easySeats[6], * brutalSeats[6];
+	for (unsigned int c0(0); c0 < 6; ++c0)
+	{
+		stopSeats[c0] = stops + c0;
+		easySeats[c0] = easy + c0;
+		brutalSeats[c0] = brutal + c0;
+	}
+	//the restore and integrate every decision below includes
+	suite.run("Restore + integrate baseline", decisions, 0, [&] {decide(stopSeats); });
+	suite.run("EasyAI decision", decisions, 0, [&] {decide(easySeats); });
+	suite.run("BrutalAI decision", decisions, 0, [&] {decide(brutalSeats); });
+
+	//whole 20-point matches the way a tournament plays them, on one thread
+	std::vector<Entrant> roster;
+	for (char code : { 'B', 'E' })
+	{
+		SeatKind kind = SeatKind(code);
+		roster.push_back(Entrant{ std::string(1, code), [kind](Physics* _physics, unsigned int _id)
+			{
+				return createPlayer(kind, _physics, _id);
+			} });
+	}
+	Tournament tournament(roster);
+	Tournament::Settings settings;
+	unsigned long long matches(64 / scale);
+	//the steps per match differ between seatings; the matches are deterministic
+	Tournament::Tally tally(2);
+	for (unsigned long long c0(0); c0 < matches; ++c0)
+		tournament.play(c0, settings, tally);
+	suite.run("Match BE, 20 points", matches, tally.frames, [&]
+		{
+			for (unsigned long long c0(0); c0 < matches; ++c0)
+			{
+				Tournament::Tally a(2);
+				tournament.play(c0, settings, a);
+				sink = sink + unsigned(a.frames);
+			}
+		});
 
-	LineSegment::Intersection i(AB.intersect(CD));
-	printf("%d", i.intersected);
-	//i.point.print();
-}
\ No newline at end of file
+	if (json)suite.json(mismatches);
+	else suite.print();
+	return mismatches ? 1 : 0;
+}